@@ -0,0 +1,132 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wiringx.h"
+#include "framer.h"
+
+#define STREAM_SIZE	(64*1024*1024)
+#define CHUNK_SIZE	4096
+#define POOL_SIZE		64
+
+char *usage =
+	"Usage: %s [megabytes]\n"
+	"       Encodes random frames and measures how fast\n"
+	"       each framer splits and decodes them again.\n";
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, struct wiringXFramerConfig_t *config, size_t total) {
+	struct wiringXFramer_t *framer = wiringXFramerSetup(config);
+	struct wiringXFrame_t frame;
+	static unsigned char pool[POOL_SIZE][256];
+	unsigned char *stream = NULL, *ptr = NULL;
+	size_t lens[POOL_SIZE], pos = 0, chunk = 0, space = 0, nrframes = 0, found = 0;
+	uint64_t check = 0;
+	double start = 0.0, encode = 0.0, decode = 0.0;
+	int ret = 0, i = 0, x = 0;
+
+	if((stream = malloc(total + 2048)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+
+	/* Random payloads with the odd byte that needs escaping */
+	srand(1);
+	for(x=0;x<POOL_SIZE;x++) {
+		lens[x] = 16 + (size_t)(rand() % 240);
+		for(i=0;i<(int)lens[x];i++) {
+			pool[x][i] = (unsigned char)rand();
+			if(config->type == FRAMER_DELIMITER && pool[x][i] == config->delimiter) {
+				pool[x][i]++;
+			}
+		}
+	}
+
+	start = now();
+	while(pos < total) {
+		x = (int)(nrframes % POOL_SIZE);
+		if((ret = wiringXFramerEncode(framer, pool[x], lens[x], &stream[pos], total + 2048 - pos)) < 0) {
+			break;
+		}
+		pos += (size_t)ret;
+		nrframes++;
+	}
+	encode = now() - start;
+	total = pos;
+
+	start = now();
+	for(pos=0;pos<total;pos+=chunk) {
+		chunk = (total - pos < CHUNK_SIZE) ? total - pos : CHUNK_SIZE;
+		ptr = wiringXFramerBuffer(framer, &space);
+		if(chunk > space) {
+			chunk = space;
+		}
+		memcpy(ptr, &stream[pos], chunk);
+		wiringXFramerCommit(framer, chunk);
+		while(wiringXFramerNext(framer, &frame) == 1) {
+			found++;
+			check += frame.data[0] + frame.data[frame.len-1];
+		}
+	}
+	decode = now() - start;
+
+	/* Touch a byte of every frame so the decode can not be skipped */
+	printf("%-10s frames %zu/%zu  encode %8.1f MB/s  decode %8.1f MB/s  (%llu)\n",
+		name, found, nrframes,
+		(double)total / encode / 1e6, (double)total / decode / 1e6,
+		(unsigned long long)(check & 0xFF));
+
+	free(stream);
+	wiringXFramerGC(framer);
+}
+
+int main(int argc, char *argv[]) {
+	struct wiringXFramerConfig_t config;
+	size_t total = STREAM_SIZE;
+
+	if(argc > 2) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+	if(argc == 2) {
+		total = (size_t)atoi(argv[1]) * 1024 * 1024;
+		if(total == 0) {
+			printf(usage, argv[0]);
+			return -1;
+		}
+	}
+
+	memset(&config, 0, sizeof(config));
+	config.type = FRAMER_DELIMITER;
+	config.delimiter = '\n';
+	run("delimiter", &config, total);
+
+	memset(&config, 0, sizeof(config));
+	config.type = FRAMER_COBS;
+	run("cobs", &config, total);
+
+	memset(&config, 0, sizeof(config));
+	config.type = FRAMER_SLIP;
+	run("slip", &config, total);
+
+	memset(&config, 0, sizeof(config));
+	config.type = FRAMER_LENGTH;
+	config.length_bytes = 2;
+	run("length", &config, total);
+
+	return 0;
+}
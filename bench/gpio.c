@@ -0,0 +1,221 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "wiringx.h"
+
+#define ITERATIONS	1000000
+/* Setup and teardown open files and map memory, run them less often */
+#define SETUP_ITERATIONS	1000
+
+char *usage =
+	"Usage: %s [-t] [iterations]\n"
+	"       Runs the GPIO functions of every platform against\n"
+	"       simulated registers and prints the cost per call\n"
+	"       as JSON. -t times every call with wiringXTiming.\n";
+
+typedef struct counters_t {
+	int cycles;
+	int instructions;
+} counters_t;
+
+static struct counters_t counters = { -1, -1 };
+static int first = 1;
+
+static void quiet(int prio, char *file, int line, const char *format, ...) {
+}
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int counter(uint64_t config) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counters_start(void) {
+	if(counters.cycles >= 0) {
+		ioctl(counters.cycles, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters.cycles, PERF_EVENT_IOC_ENABLE, 0);
+	}
+	if(counters.instructions >= 0) {
+		ioctl(counters.instructions, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters.instructions, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+static void counters_stop(int fd, double iterations, char *out, size_t size) {
+	uint64_t value = 0;
+
+	if(fd >= 0) {
+		ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		if(read(fd, &value, sizeof(value)) == sizeof(value)) {
+			snprintf(out, size, "%.1f", (double)value / iterations);
+			return;
+		}
+	}
+	snprintf(out, size, "null");
+}
+
+static void report(const char *platform, const char *op, int ret, uint64_t ns, int iterations) {
+	char cycles[32], instructions[32];
+
+	counters_stop(counters.cycles, (double)iterations, cycles, sizeof(cycles));
+	counters_stop(counters.instructions, (double)iterations, instructions, sizeof(instructions));
+
+	printf("%s\n    {\"platform\": \"%s\", \"op\": \"%s\", ", (first == 1) ? "" : ",", platform, op);
+	if(ret != 0) {
+		printf("\"error\": true}");
+	} else {
+		printf("\"iterations\": %d, \"ns_per_op\": %.2f, \"cycles_per_op\": %s, \"instructions_per_op\": %s}",
+			iterations, (double)ns / (double)iterations, cycles, instructions);
+	}
+	first = 0;
+}
+
+static int setup(const char *name) {
+	wiringXSimulate(1);
+	return wiringXSetup((char *)name, quiet);
+}
+
+static void run(const char *name, int iterations) {
+	uint64_t start = 0;
+	int gpio = 0, i = 0, ret = 0;
+
+	if(setup(name) != 0) {
+		report(name, "wiringXSetup", -1, 0, 1);
+		wiringXGC();
+		return;
+	}
+
+	/* The first pin the platform exposes */
+	for(gpio=0;gpio<256;gpio++) {
+		if(wiringXValidGPIO(gpio) == 0) {
+			break;
+		}
+	}
+	if(gpio == 256) {
+		report(name, "wiringXValidGPIO", -1, 0, 1);
+		wiringXGC();
+		return;
+	}
+
+	counters_start();
+	start = now();
+	for(i=0;i<iterations;i++) {
+		ret |= pinMode(gpio, ((i & 1) == 0) ? PINMODE_OUTPUT : PINMODE_INPUT);
+	}
+	report(name, "pinMode", ret, now() - start, iterations);
+
+	pinMode(gpio, PINMODE_OUTPUT);
+	ret = 0;
+	counters_start();
+	start = now();
+	for(i=0;i<iterations;i++) {
+		ret |= digitalWrite(gpio, ((i & 1) == 0) ? HIGH : LOW);
+	}
+	report(name, "digitalWrite", ret, now() - start, iterations);
+
+	pinMode(gpio, PINMODE_INPUT);
+	ret = 0;
+	counters_start();
+	start = now();
+	for(i=0;i<iterations;i++) {
+		if(digitalRead(gpio) < 0) {
+			ret = -1;
+		}
+	}
+	report(name, "digitalRead", ret, now() - start, iterations);
+
+	/* Needs the sysfs GPIO interface, so only on the real board */
+	ret = wiringXISR(gpio, ISR_MODE_BOTH);
+	counters_start();
+	start = now();
+	for(i=0;i<iterations/1000 && ret == 0;i++) {
+		ret = wiringXISR(gpio, ISR_MODE_BOTH);
+	}
+	report(name, "wiringXISR", ret, now() - start, iterations/1000);
+
+	wiringXGC();
+
+	ret = 0;
+	counters_start();
+	start = now();
+	for(i=0;i<SETUP_ITERATIONS && ret == 0;i++) {
+		ret = setup(name);
+		wiringXGC();
+	}
+	report(name, "wiringXSetup+wiringXGC", ret, now() - start, SETUP_ITERATIONS);
+}
+
+int main(int argc, char *argv[]) {
+	char **platforms = NULL;
+	int iterations = ITERATIONS, timing = 0, nr = 0, i = 1;
+
+	if(argc > 1 && strcmp(argv[1], "-t") == 0) {
+		timing = 1;
+		i++;
+	}
+	if(argc > i+1) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+	if(argc == i+1 && (iterations = atoi(argv[i])) <= 0) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+	if(timing == 1 && wiringXTiming(1) != 0) {
+		return -1;
+	}
+
+	/* Not every kernel allows user space to count, report null then */
+	counters.cycles = counter(PERF_COUNT_HW_CPU_CYCLES);
+	counters.instructions = counter(PERF_COUNT_HW_INSTRUCTIONS);
+
+	nr = wiringXSupportedPlatforms(&platforms);
+	wiringXGC();
+
+	printf("{\n  \"benchmark\": \"gpio\",\n  \"timing\": %s,\n  \"perf_events\": %s,\n  \"results\": [",
+		(timing == 1) ? "true" : "false",
+		(counters.cycles >= 0 || counters.instructions >= 0) ? "true" : "false");
+	for(i=0;i<nr;i++) {
+		run(platforms[i], iterations);
+		free(platforms[i]);
+	}
+	printf("\n  ]\n}\n");
+	free(platforms);
+
+	if(counters.cycles >= 0) {
+		close(counters.cycles);
+	}
+	if(counters.instructions >= 0) {
+		close(counters.instructions);
+	}
+
+	return 0;
+}
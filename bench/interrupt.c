@@ -0,0 +1,392 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include "wiringx.h"
+#include "histogram.h"
+#include "soc/soc.h"
+
+#define SAMPLES			10000
+#define GAP_US			200
+#define TIMEOUT_MS	1000
+#define LOAD_SIZE		(32*1024*1024)
+
+char *usage =
+	"Usage: %s [options]\n"
+	"       Measures the time from an edge to the return of the\n"
+	"       wait functions and prints the histograms as JSON.\n"
+	"\n"
+	"       -n samples     edges per source (default 10000)\n"
+	"       -g us          gap between edges (default 200)\n"
+	"       -l threads     load threads, odd ones stride through memory\n"
+	"       -r priority    SCHED_FIFO priority of the waiting thread\n"
+	"       -p platform    platform for the loopback test\n"
+	"       -o gpio        output pin of the loopback\n"
+	"       -i gpio        input pin of the loopback\n";
+
+enum source_t {
+	SOURCE_PIPE,
+	SOURCE_EVENTFD,
+	SOURCE_URGENT,
+	SOURCE_GPIO
+};
+
+typedef struct bench_t {
+	enum source_t source;
+	const char *api;
+	const char *name;
+	/* Waiting end and firing end */
+	int rfd;
+	int wfd;
+	int out;
+	int in;
+	int samples;
+	int gap_us;
+	int priority;
+	int timeouts;
+	uint64_t edge;
+	sem_t armed;
+	struct histogram_t histogram;
+} bench_t;
+
+static int first = 1;
+static volatile int loading = 1;
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *load(void *param) {
+	unsigned char *buf = NULL;
+	volatile uint64_t x = 1;
+	size_t i = 0;
+
+	/* Even threads only burn cycles, odd ones also evict the caches */
+	if(((intptr_t)param & 1) == 1 && (buf = malloc(LOAD_SIZE)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	while(loading == 1) {
+		if(buf != NULL) {
+			for(i=0;i<LOAD_SIZE;i+=64) {
+				buf[i]++;
+			}
+		} else {
+			for(i=0;i<100000;i++) {
+				x = x * 6364136223846793005ULL + 1;
+			}
+		}
+	}
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * A sysfs value file signals an edge with POLLPRI,
+ * which pipes and eventfds never raise. The urgent
+ * byte of a TCP connection does, so it lets the
+ * unmodified soc_wait_for_interrupt run against it.
+ */
+static int urgent(int *rfd, int *wfd) {
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int server = 0, one = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if((server = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		return -1;
+	}
+	if(bind(server, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	   listen(server, 1) < 0 ||
+	   getsockname(server, (struct sockaddr *)&addr, &len) < 0 ||
+	   (*wfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+		close(server);
+		return -1;
+	}
+	if(connect(*wfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	   (*rfd = accept(server, NULL, NULL)) < 0) {
+		close(*wfd);
+		close(server);
+		return -1;
+	}
+	close(server);
+	setsockopt(*wfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	/* The read in the wait then consumes the urgent byte and clears POLLPRI */
+	setsockopt(*rfd, SOL_SOCKET, SO_OOBINLINE, &one, sizeof(one));
+
+	/* The value the first wait reads */
+	if(write(*wfd, "0", 1) != 1) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static void fire(struct bench_t *bench, int value) {
+	eventfd_t one = 1;
+
+	__atomic_store_n(&bench->edge, now(), __ATOMIC_RELEASE);
+
+	switch(bench->source) {
+		case SOURCE_PIPE:
+			if(write(bench->wfd, "1", 1) != 1) {
+				perror("write");
+			}
+		break;
+		case SOURCE_EVENTFD:
+			eventfd_write(bench->wfd, one);
+		break;
+		case SOURCE_URGENT:
+			if(send(bench->wfd, "1", 1, MSG_OOB) != 1) {
+				perror("send");
+			}
+		break;
+		case SOURCE_GPIO:
+			digitalWrite(bench->out, value);
+		break;
+	}
+}
+
+static int wait_edge(struct bench_t *bench) {
+	struct pollfd pfd;
+	eventfd_t value = 0;
+	char c = 0;
+	int ret = 0;
+
+	switch(bench->source) {
+		case SOURCE_PIPE:
+			pfd.fd = bench->rfd;
+			pfd.events = POLLIN;
+			if((ret = poll(&pfd, 1, TIMEOUT_MS)) == 1 && read(bench->rfd, &c, 1) != 1) {
+				ret = -1;
+			}
+		break;
+		case SOURCE_EVENTFD:
+			pfd.fd = bench->rfd;
+			pfd.events = POLLIN;
+			if((ret = poll(&pfd, 1, TIMEOUT_MS)) == 1) {
+				eventfd_read(bench->rfd, &value);
+			}
+		break;
+		case SOURCE_URGENT:
+			ret = soc_wait_for_interrupt(NULL, bench->rfd, TIMEOUT_MS);
+		break;
+		case SOURCE_GPIO:
+			ret = waitForInterrupt(bench->in, TIMEOUT_MS);
+		break;
+	}
+
+	return ret;
+}
+
+static void *waiter(void *param) {
+	struct bench_t *bench = param;
+	struct sched_param sched;
+	uint64_t stop = 0;
+	int i = 0, ret = 0;
+
+	if(bench->priority > 0) {
+		memset(&sched, 0, sizeof(sched));
+		sched.sched_priority = bench->priority;
+		if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &sched) != 0) {
+			fprintf(stderr, "could not set priority %d: %s\n", bench->priority, strerror(errno));
+		}
+	}
+
+	for(i=0;i<bench->samples;i++) {
+		sem_post(&bench->armed);
+		ret = wait_edge(bench);
+		stop = now();
+		if(ret == 1) {
+			histogram_add(&bench->histogram, stop - __atomic_load_n(&bench->edge, __ATOMIC_ACQUIRE));
+		} else {
+			bench->timeouts++;
+		}
+	}
+
+	return NULL;
+}
+
+static void report(struct bench_t *bench) {
+	struct histogram_t *h = &bench->histogram;
+	int i = 0, n = 0;
+
+	printf("%s\n    {\"api\": \"%s\", \"source\": \"%s\", \"samples\": %llu, \"timeouts\": %d, ",
+		(first == 1) ? "" : ",", bench->api, bench->name,
+		(unsigned long long)histogram_count(h), bench->timeouts);
+	printf("\"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"p99.9_ns\": %llu, \"max_ns\": %llu,\n",
+		(unsigned long long)histogram_percentile(h, 50.0),
+		(unsigned long long)histogram_percentile(h, 90.0),
+		(unsigned long long)histogram_percentile(h, 99.0),
+		(unsigned long long)histogram_percentile(h, 99.9),
+		(unsigned long long)h->max);
+
+	/* Upper bound of every bucket that counted something */
+	printf("     \"histogram\": [");
+	for(i=0;i<HISTOGRAM_BUCKETS;i++) {
+		if(h->counts[i] > 0) {
+			printf("%s[%llu, %llu]", (n++ == 0) ? "" : ", ",
+				(unsigned long long)histogram_value(i), (unsigned long long)h->counts[i]);
+		}
+	}
+	printf("]}");
+	first = 0;
+}
+
+static void run(struct bench_t *bench) {
+	struct timespec gap;
+	pthread_t pth;
+	int i = 0;
+
+	gap.tv_sec = bench->gap_us / 1000000;
+	gap.tv_nsec = (long)(bench->gap_us % 1000000) * 1000L;
+
+	histogram_reset(&bench->histogram);
+	bench->timeouts = 0;
+	sem_init(&bench->armed, 0, 0);
+	pthread_create(&pth, NULL, waiter, bench);
+
+	for(i=0;i<bench->samples;i++) {
+		sem_wait(&bench->armed);
+		/* Let the waiter block in the kernel before the edge comes */
+		nanosleep(&gap, NULL);
+		fire(bench, ((i & 1) == 0) ? HIGH : LOW);
+	}
+
+	pthread_join(pth, NULL);
+	sem_destroy(&bench->armed);
+
+	report(bench);
+}
+
+int main(int argc, char *argv[]) {
+	struct bench_t bench;
+	pthread_t *loads = NULL;
+	char *platform = NULL;
+	int samples = SAMPLES, gap_us = GAP_US, nrloads = 0, priority = 0;
+	int out = -1, in = -1, fds[2], opt = 0, i = 0;
+
+	while((opt = getopt(argc, argv, "n:g:l:r:p:o:i:")) != -1) {
+		switch(opt) {
+			case 'n': samples = atoi(optarg); break;
+			case 'g': gap_us = atoi(optarg); break;
+			case 'l': nrloads = atoi(optarg); break;
+			case 'r': priority = atoi(optarg); break;
+			case 'p': platform = optarg; break;
+			case 'o': out = atoi(optarg); break;
+			case 'i': in = atoi(optarg); break;
+			default:
+				printf(usage, argv[0]);
+				return -1;
+		}
+	}
+	if(samples <= 0 || gap_us < 0 || nrloads < 0 ||
+	   (platform != NULL && (out < 0 || in < 0))) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+
+	if(nrloads > 0) {
+		if((loads = malloc(sizeof(pthread_t)*(size_t)nrloads)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		for(i=0;i<nrloads;i++) {
+			pthread_create(&loads[i], NULL, load, (void *)(intptr_t)i);
+		}
+	}
+
+	memset(&bench, 0, sizeof(bench));
+	bench.samples = samples;
+	bench.gap_us = gap_us;
+	bench.priority = priority;
+
+	printf("{\n  \"benchmark\": \"interrupt\",\n  \"gap_us\": %d,\n  \"load_threads\": %d,\n  \"priority\": %d,\n  \"results\": [",
+		gap_us, nrloads, priority);
+
+	if(pipe(fds) == 0) {
+		bench.source = SOURCE_PIPE;
+		bench.api = "poll";
+		bench.name = "pipe";
+		bench.rfd = fds[0];
+		bench.wfd = fds[1];
+		run(&bench);
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	if((fds[0] = eventfd(0, 0)) >= 0) {
+		bench.source = SOURCE_EVENTFD;
+		bench.api = "poll";
+		bench.name = "eventfd";
+		bench.rfd = fds[0];
+		bench.wfd = fds[0];
+		run(&bench);
+		close(fds[0]);
+	}
+
+	if(urgent(&fds[0], &fds[1]) == 0) {
+		bench.source = SOURCE_URGENT;
+		bench.api = "soc_wait_for_interrupt";
+		bench.name = "tcp-urgent";
+		bench.rfd = fds[0];
+		bench.wfd = fds[1];
+		run(&bench);
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	/* Needs the output wired to the input on a real board */
+	if(platform != NULL) {
+		if(wiringXSetup(platform, NULL) == 0 &&
+		   pinMode(out, PINMODE_OUTPUT) == 0 &&
+		   digitalWrite(out, LOW) == 0 &&
+		   wiringXISR(in, ISR_MODE_BOTH) == 0) {
+			bench.source = SOURCE_GPIO;
+			bench.api = "waitForInterrupt";
+			bench.name = "gpio-loopback";
+			bench.out = out;
+			bench.in = in;
+			run(&bench);
+		} else {
+			fprintf(stderr, "could not setup the loopback from %d to %d on %s\n", out, in, platform);
+		}
+		wiringXGC();
+	}
+
+	printf("\n  ]\n}\n");
+
+	loading = 0;
+	for(i=0;i<nrloads;i++) {
+		pthread_join(loads[i], NULL);
+	}
+	free(loads);
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pty.h>
+#include <pthread.h>
+#include <termios.h>
+
+#include "wiringx.h"
+#include "modbus.h"
+
+#define SLAVE		17
+#define ITEMS		32
+#define ITEM_SIZE	4
+/* Two unused registers between every item */
+#define ITEM_STRIDE	6
+#define ROUNDS		20
+
+char *usage =
+	"Usage: %s [rounds]\n"
+	"       Polls %d register ranges from a slave stand-in on\n"
+	"       a pseudo terminal, one request per range and merged.\n";
+
+static uint16_t registers[0x10000];
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int readn(int fd, unsigned char *buf, size_t len) {
+	return (wiringXSerialRead(fd, buf, len, 5000) == (int)len) ? 0 : -1;
+}
+
+/* Answers read and write requests until the terminal closes */
+static void *slave(void *param) {
+	int fd = *(int *)param;
+	unsigned char req[260], resp[260];
+	size_t len = 0, rlen = 0;
+	uint16_t crc = 0;
+	int addr = 0, count = 0, i = 0;
+
+	while(1) {
+		if(readn(fd, req, 8) != 0) {
+			break;
+		}
+		len = 8;
+		if(req[1] == MODBUS_WRITE_MULTIPLE) {
+			if(readn(fd, &req[8], (size_t)req[6] + 1) != 0) {
+				break;
+			}
+			len += (size_t)req[6] + 1;
+		}
+		if(wiringXModbusCRC(req, len) != 0 || req[0] != SLAVE) {
+			continue;
+		}
+
+		addr = (req[2] << 8) | req[3];
+		count = (req[4] << 8) | req[5];
+		resp[0] = req[0];
+		resp[1] = req[1];
+
+		switch(req[1]) {
+			case MODBUS_READ_HOLDING:
+			case MODBUS_READ_INPUT:
+				resp[2] = (unsigned char)(2*count);
+				for(i=0;i<count;i++) {
+					resp[3+2*i] = (unsigned char)(registers[addr+i] >> 8);
+					resp[4+2*i] = (unsigned char)(registers[addr+i] & 0xFF);
+				}
+				rlen = 3 + 2*(size_t)count;
+			break;
+			case MODBUS_WRITE_SINGLE:
+				registers[addr] = (uint16_t)count;
+				memcpy(resp, req, 6);
+				rlen = 6;
+			break;
+			case MODBUS_WRITE_MULTIPLE:
+				for(i=0;i<count;i++) {
+					registers[addr+i] = (uint16_t)((req[7+2*i] << 8) | req[8+2*i]);
+				}
+				memcpy(resp, req, 6);
+				rlen = 6;
+			break;
+			default:
+				resp[1] |= 0x80;
+				resp[2] = 0x01;
+				rlen = 3;
+			break;
+		}
+
+		crc = wiringXModbusCRC(resp, rlen);
+		resp[rlen++] = (unsigned char)(crc & 0xFF);
+		resp[rlen++] = (unsigned char)(crc >> 8);
+		wiringXSerialWrite(fd, resp, rlen);
+	}
+
+	return NULL;
+}
+
+static void report(const char *name, struct wiringXModbus_t *mb, int rounds, double elapsed) {
+	struct wiringXModbusStats_t stats;
+
+	wiringXModbusStats(mb, &stats);
+	printf("%-8s %6llu requests %8.1f req/s %9.1f reg/s  timeouts %llu  crc %llu\n",
+		name, (unsigned long long)stats.requests,
+		(double)stats.requests / elapsed,
+		(double)(rounds * ITEMS * ITEM_SIZE) / elapsed,
+		(unsigned long long)stats.timeouts, (unsigned long long)stats.crc_errors);
+}
+
+static int check(uint16_t values[ITEMS][ITEM_SIZE]) {
+	int i = 0, x = 0;
+
+	for(i=0;i<ITEMS;i++) {
+		for(x=0;x<ITEM_SIZE;x++) {
+			if(values[i][x] != registers[i*ITEM_STRIDE+x]) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	struct wiringXModbus_t *mb = NULL;
+	struct termios options;
+	static uint16_t values[ITEMS][ITEM_SIZE];
+	pthread_t thread;
+	double start = 0.0;
+	int master = 0, fd = 0, rounds = ROUNDS, i = 0, r = 0;
+
+	if(argc > 2) {
+		printf(usage, argv[0], ITEMS);
+		return -1;
+	}
+	if(argc == 2 && (rounds = atoi(argv[1])) <= 0) {
+		printf(usage, argv[0], ITEMS);
+		return -1;
+	}
+
+	if(openpty(&master, &fd, NULL, NULL, NULL) < 0) {
+		perror("openpty");
+		return -1;
+	}
+	tcgetattr(master, &options);
+	cfmakeraw(&options);
+	tcsetattr(master, TCSANOW, &options);
+	tcsetattr(fd, TCSANOW, &options);
+
+	for(i=0;i<0x10000;i++) {
+		registers[i] = (uint16_t)(i * 7);
+	}
+	pthread_create(&thread, NULL, slave, &fd);
+
+	printf("%d ranges of %d registers, gap %d registers\n", ITEMS, ITEM_SIZE, ITEM_STRIDE - ITEM_SIZE);
+
+	mb = wiringXModbusSetup(master, 1000);
+	start = now();
+	for(r=0;r<rounds;r++) {
+		for(i=0;i<ITEMS;i++) {
+			wiringXModbusReadRegisters(mb, SLAVE, MODBUS_READ_HOLDING, i*ITEM_STRIDE, ITEM_SIZE, values[i]);
+		}
+	}
+	report("single", mb, rounds, now() - start);
+	if(check(values) != 0) {
+		printf("single   register values do not match\n");
+	}
+	wiringXModbusGC(mb);
+
+	memset(values, 0, sizeof(values));
+	mb = wiringXModbusSetup(master, 1000);
+	for(i=0;i<ITEMS;i++) {
+		wiringXModbusPollAdd(mb, SLAVE, MODBUS_READ_HOLDING, i*ITEM_STRIDE, ITEM_SIZE, 0, values[i]);
+	}
+	start = now();
+	for(r=0;r<rounds;r++) {
+		wiringXModbusPollRun(mb);
+	}
+	report("merged", mb, rounds, now() - start);
+	if(check(values) != 0) {
+		printf("merged   register values do not match\n");
+	}
+	wiringXModbusGC(mb);
+
+	close(master);
+	close(fd);
+	pthread_join(thread, NULL);
+
+	return 0;
+}
@@ -0,0 +1,436 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pty.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "wiringx.h"
+#include "serial-reader.h"
+
+#define CHUNK_SIZE	4096
+#define ECHO_SIZE		64
+#define SAMPLES			2000
+
+char *usage =
+	"Usage: %s [megabytes]\n"
+	"       Measures the serial functions on a pseudo terminal\n"
+	"       pair and prints the results as JSON.\n";
+
+static int master = 0;
+static int fd = 0;
+static int first = 1;
+
+/*
+ * Every system call is counted through the
+ * raw_syscalls:sys_enter tracepoint, which needs
+ * tracefs and perf permissions. The read and write
+ * calls from /proc/self/io are always available but
+ * miss the poll and eventfd calls of the reader.
+ */
+typedef struct count_t {
+	int perf;
+	uint64_t rw;
+} count_t;
+
+static uint64_t now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Read and write system calls of this process so far */
+static uint64_t rwcalls(void) {
+	FILE *fp = NULL;
+	char line[128];
+	unsigned long long n = 0, total = 0;
+
+	if((fp = fopen("/proc/self/io", "r")) == NULL) {
+		return 0;
+	}
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		if(sscanf(line, "syscr: %llu", &n) == 1 || sscanf(line, "syscw: %llu", &n) == 1) {
+			total += n;
+		}
+	}
+	fclose(fp);
+
+	return (uint64_t)total;
+}
+
+static int tracepoint(void) {
+	char *paths[] = {
+		"/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+		"/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id",
+		NULL
+	};
+	unsigned long long id = 0;
+	FILE *fp = NULL;
+	int i = 0, ok = 0;
+
+	for(i=0;paths[i]!=NULL && ok==0;i++) {
+		if((fp = fopen(paths[i], "r")) != NULL) {
+			ok = (fscanf(fp, "%llu", &id) == 1);
+			fclose(fp);
+		}
+	}
+	return (ok == 1) ? (int)id : -1;
+}
+
+/*
+ * Start counting after the peer has been forked, the
+ * counter is inherited by threads started from here
+ * on but must not follow the peer process.
+ */
+static void count_start(struct count_t *count) {
+	struct perf_event_attr attr;
+	int id = tracepoint();
+
+	count->perf = -1;
+	if(id >= 0) {
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_TRACEPOINT;
+		attr.size = sizeof(attr);
+		attr.config = (uint64_t)id;
+		attr.inherit = 1;
+		count->perf = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+	count->rw = rwcalls();
+}
+
+/* Inherited counts are only added once their thread has exited */
+static void count_stop(struct count_t *count, int64_t *calls, uint64_t *rw) {
+	uint64_t value = 0;
+
+	*rw = rwcalls() - count->rw;
+	*calls = -1;
+	if(count->perf >= 0) {
+		if(read(count->perf, &value, sizeof(value)) == sizeof(value)) {
+			*calls = (int64_t)value;
+		}
+		close(count->perf);
+	}
+}
+
+/* Runs on the other end of the terminal in a child process */
+static pid_t peer(int mode, size_t total) {
+	unsigned char buf[CHUNK_SIZE];
+	size_t done = 0;
+	ssize_t n = 0;
+	pid_t pid = 0;
+
+	if((pid = fork()) != 0) {
+		return pid;
+	}
+
+	memset(buf, 'x', sizeof(buf));
+	switch(mode) {
+		/* Feed total bytes */
+		case 0:
+			while(done < total) {
+				n = (total - done < sizeof(buf)) ? (ssize_t)(total - done) : (ssize_t)sizeof(buf);
+				if((n = write(master, buf, (size_t)n)) <= 0) {
+					break;
+				}
+				done += (size_t)n;
+			}
+		break;
+		/* Drain total bytes */
+		case 1:
+			while(done < total && (n = read(master, buf, sizeof(buf))) > 0) {
+				done += (size_t)n;
+			}
+		break;
+		/* Echo until killed */
+		default:
+			while((n = read(master, buf, sizeof(buf))) > 0) {
+				if(write(master, buf, (size_t)n) != n) {
+					break;
+				}
+			}
+		break;
+	}
+	_exit(0);
+}
+
+static void finish(pid_t pid) {
+	int status = 0;
+	waitpid(pid, &status, 0);
+}
+
+static void result(const char *api, const char *direction, size_t total, uint64_t ns, int64_t calls, uint64_t rw) {
+	char syscalls[32];
+
+	if(calls >= 0) {
+		snprintf(syscalls, sizeof(syscalls), "%.4f", (double)calls / (double)total);
+	} else {
+		snprintf(syscalls, sizeof(syscalls), "null");
+	}
+	printf("%s\n    {\"api\": \"%s\", \"direction\": \"%s\", \"bytes\": %zu, \"bytes_per_s\": %.0f, \"syscalls_per_byte\": %s, \"read_write_calls_per_byte\": %.4f}",
+		(first == 1) ? "" : ",", api, direction, total,
+		(double)total * 1e9 / (double)ns, syscalls, (double)rw / (double)total);
+	first = 0;
+}
+
+static void rx_getchar(size_t total) {
+	struct count_t count;
+	uint64_t start = 0, rw = 0;
+	int64_t calls = 0;
+	size_t done = 0;
+	pid_t pid = peer(0, total);
+
+	count_start(&count);
+	start = now();
+	while(done < total && wiringXSerialGetChar(fd) >= 0) {
+		done++;
+	}
+	start = now() - start;
+	count_stop(&count, &calls, &rw);
+	finish(pid);
+
+	result("wiringXSerialGetChar", "rx", done, start, calls, rw);
+}
+
+static void rx_read(size_t total) {
+	unsigned char buf[CHUNK_SIZE];
+	struct count_t count;
+	uint64_t start = 0, rw = 0;
+	int64_t calls = 0;
+	size_t done = 0;
+	int n = 0;
+	pid_t pid = peer(0, total);
+
+	count_start(&count);
+	start = now();
+	while(done < total && (n = wiringXSerialRead(fd, buf, sizeof(buf), 1000)) > 0) {
+		done += (size_t)n;
+	}
+	start = now() - start;
+	count_stop(&count, &calls, &rw);
+	finish(pid);
+
+	result("wiringXSerialRead", "rx", done, start, calls, rw);
+}
+
+static void rx_reader(size_t total) {
+	struct wiringXSerialReader_t *reader = NULL;
+	struct pollfd pfd;
+	unsigned char buf[CHUNK_SIZE];
+	struct count_t count;
+	uint64_t start = 0, rw = 0;
+	int64_t calls = 0;
+	eventfd_t ev = 0;
+	size_t done = 0;
+	int port = 0, n = 0;
+	pid_t pid = peer(0, total);
+
+	/* The reader thread has to start after the counter to be counted */
+	count_start(&count);
+	if((reader = wiringXSerialReaderStart(0)) == NULL || (port = wiringXSerialReaderAdd(reader, fd, 1024*1024, NULL, NULL)) < 0) {
+		kill(pid, SIGTERM);
+		finish(pid);
+		return;
+	}
+	pfd.fd = wiringXSerialReaderEventFd(reader, port);
+	pfd.events = POLLIN;
+
+	start = now();
+	while(done < total) {
+		if(poll(&pfd, 1, 1000) <= 0) {
+			break;
+		}
+		eventfd_read(pfd.fd, &ev);
+		while((n = wiringXSerialReaderRead(reader, port, buf, sizeof(buf))) > 0) {
+			done += (size_t)n;
+		}
+	}
+	start = now() - start;
+	wiringXSerialReaderStop(reader);
+	count_stop(&count, &calls, &rw);
+	finish(pid);
+	/* The reader made the port non-blocking */
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+	result("wiringXSerialReader", "rx", done, start, calls, rw);
+}
+
+static void tx(const char *api, size_t total) {
+	char buf[CHUNK_SIZE+1];
+	struct count_t count;
+	uint64_t start = 0, rw = 0;
+	int64_t calls = 0;
+	size_t done = 0, len = 0;
+	pid_t pid = peer(1, total);
+
+	memset(buf, 'x', sizeof(buf));
+	count_start(&count);
+	start = now();
+	if(strcmp(api, "wiringXSerialPutChar") == 0) {
+		for(done=0;done<total;done++) {
+			wiringXSerialPutChar(fd, 'x');
+		}
+	} else if(strcmp(api, "wiringXSerialPuts") == 0) {
+		buf[ECHO_SIZE] = 0;
+		for(done=0;done<total;done+=ECHO_SIZE) {
+			wiringXSerialPuts(fd, buf);
+		}
+	} else {
+		for(done=0;done<total;done+=len) {
+			len = (total - done < CHUNK_SIZE) ? total - done : CHUNK_SIZE;
+			if(wiringXSerialWrite(fd, buf, len) != (int)len) {
+				break;
+			}
+		}
+	}
+	/* Until the other end received everything */
+	finish(pid);
+	start = now() - start;
+	count_stop(&count, &calls, &rw);
+
+	result(api, "tx", done, start, calls, rw);
+}
+
+static int cmp(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void latency(const char *api, uint64_t *samples, int n) {
+	if(n == 0) {
+		printf("%s\n    {\"api\": \"%s\", \"samples\": 0}", (first == 1) ? "" : ",", api);
+		first = 0;
+		return;
+	}
+	qsort(samples, (size_t)n, sizeof(uint64_t), cmp);
+	printf("%s\n    {\"api\": \"%s\", \"samples\": %d, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu}",
+		(first == 1) ? "" : ",", api, n,
+		(unsigned long long)samples[n/2], (unsigned long long)samples[n*9/10],
+		(unsigned long long)samples[n*99/100], (unsigned long long)samples[n-1]);
+	first = 0;
+}
+
+static void echo(void) {
+	static uint64_t samples[SAMPLES];
+	struct wiringXSerialReader_t *reader = NULL;
+	struct pollfd pfd;
+	unsigned char buf[ECHO_SIZE];
+	uint64_t start = 0;
+	eventfd_t ev = 0;
+	int i = 0, n = 0, got = 0, port = 0;
+	pid_t pid = peer(2, 0);
+
+	memset(buf, 'x', sizeof(buf));
+
+	for(i=0;i<SAMPLES;i++) {
+		start = now();
+		wiringXSerialPutChar(fd, 'x');
+		if(wiringXSerialGetChar(fd) < 0) {
+			break;
+		}
+		samples[i] = now() - start;
+	}
+	latency("wiringXSerialPutChar+GetChar", samples, i);
+
+	for(i=0;i<SAMPLES;i++) {
+		start = now();
+		wiringXSerialWrite(fd, buf, sizeof(buf));
+		if(wiringXSerialRead(fd, buf, sizeof(buf), 1000) != sizeof(buf)) {
+			break;
+		}
+		samples[i] = now() - start;
+	}
+	latency("wiringXSerialWrite+Read", samples, i);
+
+	if((reader = wiringXSerialReaderStart(0)) != NULL &&
+	   (port = wiringXSerialReaderAdd(reader, fd, 64*1024, NULL, NULL)) >= 0) {
+		pfd.fd = wiringXSerialReaderEventFd(reader, port);
+		pfd.events = POLLIN;
+		for(i=0;i<SAMPLES;i++) {
+			start = now();
+			wiringXSerialWrite(fd, buf, sizeof(buf));
+			for(got=0;got<(int)sizeof(buf);got+=n) {
+				if(poll(&pfd, 1, 1000) <= 0) {
+					break;
+				}
+				eventfd_read(pfd.fd, &ev);
+				if((n = wiringXSerialReaderRead(reader, port, &buf[got], sizeof(buf) - (size_t)got)) < 0) {
+					break;
+				}
+			}
+			if(got < (int)sizeof(buf)) {
+				break;
+			}
+			samples[i] = now() - start;
+		}
+		latency("wiringXSerialWrite+SerialReader", samples, i);
+		wiringXSerialReaderStop(reader);
+	}
+
+	kill(pid, SIGTERM);
+	finish(pid);
+}
+
+int main(int argc, char *argv[]) {
+	struct wiringXSerial_t config = { 115200, 8, 'n', 1, 'n' };
+	struct termios options;
+	size_t total = 16*1024*1024;
+	int slave = 0;
+
+	if(argc > 2) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+	if(argc == 2 && (total = (size_t)atoi(argv[1]) * 1024 * 1024) == 0) {
+		printf(usage, argv[0]);
+		return -1;
+	}
+
+	if(openpty(&master, &slave, NULL, NULL, NULL) < 0) {
+		perror("openpty");
+		return -1;
+	}
+	tcgetattr(master, &options);
+	cfmakeraw(&options);
+	tcsetattr(master, TCSANOW, &options);
+
+	if((fd = wiringXSerialOpen(ttyname(slave), config)) < 0) {
+		fprintf(stderr, "failed to open %s\n", ttyname(slave));
+		return -1;
+	}
+	close(slave);
+
+	printf("{\n  \"benchmark\": \"serial\",\n  \"baud\": %u,\n  \"throughput\": [", config.baud);
+	/* One system call per byte, keep it short */
+	rx_getchar(total / 64);
+	rx_read(total);
+	rx_reader(total);
+	tx("wiringXSerialPutChar", total / 64);
+	tx("wiringXSerialPuts", total / 4);
+	tx("wiringXSerialWrite", total);
+	printf("\n  ],\n  \"latency\": [");
+	first = 1;
+	echo();
+	printf("\n  ]\n}\n");
+
+	wiringXSerialClose(fd);
+	close(master);
+
+	return 0;
+}
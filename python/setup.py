@@ -9,7 +9,23 @@ modules = [
 		sources=[
 			'wiringX/wiringx.c',
 			'../src/i2c-dev.c',
+			'../src/i2c-bus.c',
+			'../src/i2c-poller.c',
+			'../src/regmap.c',
 			'../src/wiringx.c',
+			'../src/termios2.c',
+			'../src/rs485.c',
+			'../src/ring.c',
+			'../src/histogram.c',
+			'../src/stats.c',
+			'../src/timing.c',
+			'../src/spi-sampler.c',
+			'../src/serial-reader.c',
+			'../src/serial-capture.c',
+			'../src/framer.c',
+			'../src/modbus.c',
+			'../src/ledstrip.c',
+			'../src/display.c',
 			'../src/soc/soc.c',
 			'../src/soc/allwinner/a10.c',
 			'../src/soc/allwinner/a31s.c',
@@ -20,6 +36,7 @@ modules = [
 			'../src/soc/broadcom/2835.c',
 			'../src/soc/broadcom/2836.c',
 			'../src/soc/broadcom/2711.c',
+			'../src/soc/broadcom/spi0.c',
 			'../src/soc/nxp/imx6sdlrm.c',
 			'../src/soc/nxp/imx6dqrm.c',
 			'../src/soc/samsung/exynos5422.c',
@@ -22,6 +22,8 @@
 #include <sys/wait.h>
 #include <pthread.h>
 
+/* Lengths of "#" formats are Py_ssize_t, required since Python 3.10 */
+#define PY_SSIZE_T_CLEAN
 #include "Python.h"
 
 #include "wiringx.h"
@@ -246,6 +248,78 @@ static PyObject *py_I2CWriteReg16(PyObject *self, PyObject *args) {
 	}
 }
 
+static PyObject *py_I2CBytes(const unsigned char *buf, int len) {
+#if PY_MAJOR_VERSION >= 3
+	return Py_BuildValue("y#", buf, (Py_ssize_t)len);
+#else
+	return Py_BuildValue("s#", buf, (Py_ssize_t)len);
+#endif
+}
+
+static PyObject *py_I2CReadBlock(PyObject *self, PyObject *args) {
+	unsigned char buf[I2C_BLOCK_MAX];
+	int fd = 0, reg = 0, len = 0;
+
+	if(!PyArg_ParseTuple(args, "ii", &fd, &reg)) {
+		return NULL;
+	}
+
+	if((len = wiringXI2CReadBlock(fd, reg, buf)) < 0) {
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	return py_I2CBytes(buf, len);
+}
+
+static PyObject *py_I2CReadI2CBlock(PyObject *self, PyObject *args) {
+	unsigned char buf[I2C_BLOCK_MAX];
+	int fd = 0, reg = 0, len = 0;
+
+	if(!PyArg_ParseTuple(args, "iii", &fd, &reg, &len)) {
+		return NULL;
+	}
+
+	if((len = wiringXI2CReadI2CBlock(fd, reg, buf, len)) < 0) {
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+
+	return py_I2CBytes(buf, len);
+}
+
+static PyObject *py_I2CWriteBlock(PyObject *self, PyObject *args) {
+	int fd = 0, reg = 0, ret = 0;
+	Py_buffer data;
+
+	if(!PyArg_ParseTuple(args, "iis*", &fd, &reg, &data)) {
+		return NULL;
+	}
+
+	ret = wiringXI2CWriteBlock(fd, reg, (const unsigned char *)data.buf, (int)data.len);
+	PyBuffer_Release(&data);
+
+	if(ret < 0) {
+		Py_RETURN_FALSE;
+	}
+	Py_RETURN_TRUE;
+}
+
+static PyObject *py_I2CWriteI2CBlock(PyObject *self, PyObject *args) {
+	int fd = 0, reg = 0, ret = 0;
+	Py_buffer data;
+
+	if(!PyArg_ParseTuple(args, "iis*", &fd, &reg, &data)) {
+		return NULL;
+	}
+
+	ret = wiringXI2CWriteI2CBlock(fd, reg, (const unsigned char *)data.buf, (int)data.len);
+	PyBuffer_Release(&data);
+
+	if(ret < 0) {
+		Py_RETURN_FALSE;
+	}
+	Py_RETURN_TRUE;
+}
+
 static PyObject *py_setupI2C(PyObject *self, PyObject *args) {
 	int device = 0;
 	char *path = NULL;
@@ -296,6 +370,17 @@ static PyObject *py_setupSPI(PyObject *self, PyObject *args) {
 	return Py_BuildValue("i", wiringXSPISetup(channel, speed));
 }
 
+static PyObject *py_setupSPIMode(PyObject *self, PyObject *args) {
+	int channel = 0, speed = 0;
+	unsigned int mode = 0;
+
+	if(!PyArg_ParseTuple(args, "iiI", &channel, &speed, &mode)) {
+		return NULL;
+	}
+
+	return Py_BuildValue("i", wiringXSPISetupMode(channel, speed, mode));
+}
+
 static PyObject *py_setup(PyObject *self, PyObject *args) {
 	char gpio[8];
 	int pin = 0;
@@ -338,9 +423,14 @@ static PyMethodDef module_methods[] = {
     {"I2CWrite", py_I2CWrite, METH_VARARGS, "Write to I2C device"},
     {"I2CWriteReg8", py_I2CWriteReg8, METH_VARARGS, "Write to I2C device"},
     {"I2CWriteReg16", py_I2CWriteReg16, METH_VARARGS, "Write to I2C device"},
+    {"I2CReadBlock", py_I2CReadBlock, METH_VARARGS, "Read SMBus block from I2C device"},
+    {"I2CWriteBlock", py_I2CWriteBlock, METH_VARARGS, "Write SMBus block to I2C device"},
+    {"I2CReadI2CBlock", py_I2CReadI2CBlock, METH_VARARGS, "Read I2C block from I2C device"},
+    {"I2CWriteI2CBlock", py_I2CWriteI2CBlock, METH_VARARGS, "Write I2C block to I2C device"},
     {"SPIGetFd", py_SPIGetFd, METH_VARARGS, "Get SPI file descriptor for channel"},
     {"SPIDataRW", py_SPIDataRW, METH_VARARGS, "Read / write SPI device"},
     {"SPISetup", py_setupSPI, METH_VARARGS, "Setup SPI device"},
+    {"SPISetupMode", py_setupSPIMode, METH_VARARGS, "Setup SPI device with mode flags"},
     /*{"ISR", py_wiringXISR, METH_VARARGS,	"Set pin to interrupt"},
     {"waitForInterrupt", py_waitForInterrupt, METH_VARARGS,	"Wait for interrupt"},*/
 		
@@ -384,6 +474,18 @@ PyMODINIT_FUNC initgpio(void) {
 	PyModule_AddObject(module, "ISR_MODE_FALLING", Py_BuildValue("i", ISR_MODE_FALLING));
 	PyModule_AddObject(module, "ISR_MODE_BOTH", Py_BuildValue("i", ISR_MODE_BOTH));
 	PyModule_AddObject(module, "ISR_MODE_NONE", Py_BuildValue("i", ISR_MODE_NONE));
+	PyModule_AddObject(module, "SPIMODE_0", Py_BuildValue("i", SPIMODE_0));
+	PyModule_AddObject(module, "SPIMODE_1", Py_BuildValue("i", SPIMODE_1));
+	PyModule_AddObject(module, "SPIMODE_2", Py_BuildValue("i", SPIMODE_2));
+	PyModule_AddObject(module, "SPIMODE_3", Py_BuildValue("i", SPIMODE_3));
+	PyModule_AddObject(module, "SPIMODE_CS_HIGH", Py_BuildValue("i", SPIMODE_CS_HIGH));
+	PyModule_AddObject(module, "SPIMODE_LSB_FIRST", Py_BuildValue("i", SPIMODE_LSB_FIRST));
+	PyModule_AddObject(module, "SPIMODE_3WIRE", Py_BuildValue("i", SPIMODE_3WIRE));
+	PyModule_AddObject(module, "SPIMODE_NO_CS", Py_BuildValue("i", SPIMODE_NO_CS));
+	PyModule_AddObject(module, "SPIMODE_TX_DUAL", Py_BuildValue("i", SPIMODE_TX_DUAL));
+	PyModule_AddObject(module, "SPIMODE_TX_QUAD", Py_BuildValue("i", SPIMODE_TX_QUAD));
+	PyModule_AddObject(module, "SPIMODE_RX_DUAL", Py_BuildValue("i", SPIMODE_RX_DUAL));
+	PyModule_AddObject(module, "SPIMODE_RX_QUAD", Py_BuildValue("i", SPIMODE_RX_QUAD));
 
 	/*
 	 * All platforms supported
@@ -0,0 +1,443 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+#endif
+
+#include "wiringx.h"
+#include "display.h"
+
+#define ST7789_SWRESET	0x01
+#define ST7789_SLPOUT		0x11
+#define ST7789_NORON		0x13
+#define ST7789_INVON		0x21
+#define ST7789_DISPON		0x29
+#define ST7789_CASET		0x2A
+#define ST7789_RASET		0x2B
+#define ST7789_RAMWR		0x2C
+#define ST7789_MADCTL		0x36
+#define ST7789_COLMOD		0x3A
+
+/*
+ * Window setup costs six small transfers, which is
+ * weighed as this many pixel bytes when deciding
+ * whether two dirty areas are merged.
+ */
+#define DISPLAY_RECT_COST	256
+
+#define DISPLAY_MAX_SEGMENTS	64
+
+struct display_rect_t {
+	int x0, x1;
+	int y0, y1;
+};
+
+typedef struct wiringXDisplay_t {
+	struct wiringXDisplayConfig_t config;
+	unsigned char *previous;
+	int valid;
+	size_t stride;
+	size_t chunk;
+
+	int *span;
+	struct display_rect_t *rects;
+
+	struct wiringXDisplayStats_t stats;
+} wiringXDisplay_t;
+
+#if defined(__SSE2__)
+static int display_first_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = 0, mask = 0;
+
+	for(i=0;i+16<=len;i+=16) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&a[i]), _mm_loadu_si128((const __m128i *)&b[i])));
+		if(mask != 0xFFFF) {
+			return i + __builtin_ctz(~mask & 0xFFFF);
+		}
+	}
+	for(;i<len;i++) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int display_last_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = len, mask = 0;
+
+	for(;i-16>=0;i-=16) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)&a[i-16]), _mm_loadu_si128((const __m128i *)&b[i-16])));
+		if(mask != 0xFFFF) {
+			return i - 16 + (31 - __builtin_clz(~mask & 0xFFFF));
+		}
+	}
+	for(i--;i>=0;i--) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static int display_block_differs(const unsigned char *a, const unsigned char *b) {
+	uint64x2_t x = vreinterpretq_u64_u8(veorq_u8(vld1q_u8(a), vld1q_u8(b)));
+	return (vgetq_lane_u64(x, 0) | vgetq_lane_u64(x, 1)) != 0;
+}
+
+static int display_first_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = 0;
+
+	for(i=0;i+16<=len;i+=16) {
+		if(display_block_differs(&a[i], &b[i])) {
+			break;
+		}
+	}
+	for(;i<len;i++) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int display_last_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = len;
+
+	for(;i-16>=0;i-=16) {
+		if(display_block_differs(&a[i-16], &b[i-16])) {
+			break;
+		}
+	}
+	for(i--;i>=0;i--) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+#else
+static int display_first_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = 0;
+
+	for(i=0;i<len;i++) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int display_last_diff(const unsigned char *a, const unsigned char *b, int len) {
+	int i = 0;
+
+	for(i=len-1;i>=0;i--) {
+		if(a[i] != b[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+#endif
+
+static int display_command(struct wiringXDisplay_t *display, unsigned char cmd, const unsigned char *data, int len) {
+	struct wiringXSPITransfer_t xfer;
+
+	memset(&xfer, 0, sizeof(xfer));
+	xfer.tx = &cmd;
+	xfer.len = 1;
+
+	digitalWrite(display->config.dc_pin, LOW);
+	if(wiringXSPITransfer(display->config.channel, &xfer, 1) < 0) {
+		return -1;
+	}
+	digitalWrite(display->config.dc_pin, HIGH);
+
+	if(len > 0) {
+		xfer.tx = data;
+		xfer.len = (unsigned int)len;
+		if(wiringXSPITransfer(display->config.channel, &xfer, 1) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int display_window(struct wiringXDisplay_t *display, struct display_rect_t *rect) {
+	unsigned char data[4];
+	int x0 = rect->x0 + display->config.x_offset;
+	int x1 = rect->x1 + display->config.x_offset;
+	int y0 = rect->y0 + display->config.y_offset;
+	int y1 = rect->y1 + display->config.y_offset;
+
+	data[0] = (x0 >> 8) & 0xFF; data[1] = x0 & 0xFF;
+	data[2] = (x1 >> 8) & 0xFF; data[3] = x1 & 0xFF;
+	if(display_command(display, ST7789_CASET, data, 4) < 0) {
+		return -1;
+	}
+
+	data[0] = (y0 >> 8) & 0xFF; data[1] = y0 & 0xFF;
+	data[2] = (y1 >> 8) & 0xFF; data[3] = y1 & 0xFF;
+	if(display_command(display, ST7789_RASET, data, 4) < 0) {
+		return -1;
+	}
+
+	return display_command(display, ST7789_RAMWR, NULL, 0);
+}
+
+/*
+ * Sends the pixels of one rectangle straight out of
+ * the caller's frame. Rows are gathered as segments
+ * of one SPI message, bounded by the spidev buffer.
+ */
+static int display_send_rect(struct wiringXDisplay_t *display, const unsigned char *frame, struct display_rect_t *rect) {
+	struct wiringXSPITransfer_t xfers[DISPLAY_MAX_SEGMENTS];
+	size_t rowlen = (size_t)(rect->x1 - rect->x0 + 1) * 2;
+	size_t total = 0, pos = 0, len = 0, end = 0;
+	const unsigned char *row = NULL;
+	int n = 0, y = 0;
+
+	if(display_window(display, rect) < 0) {
+		return -1;
+	}
+
+	memset(xfers, 0, sizeof(xfers));
+
+	/* Full width rows are one contiguous block */
+	if(rowlen == display->stride) {
+		row = &frame[(size_t)rect->y0 * display->stride];
+		end = (size_t)(rect->y1 - rect->y0 + 1) * display->stride;
+		for(pos=0;pos<end;pos+=len) {
+			len = (end - pos > display->chunk) ? display->chunk : end - pos;
+			xfers[0].tx = &row[pos];
+			xfers[0].len = (unsigned int)len;
+			if(wiringXSPITransfer(display->config.channel, xfers, 1) < 0) {
+				return -1;
+			}
+		}
+		display->stats.bytes += end;
+		return 0;
+	}
+
+	for(y=rect->y0;y<=rect->y1;y++) {
+		row = &frame[(size_t)y * display->stride + (size_t)rect->x0 * 2];
+		for(pos=0;pos<rowlen;pos+=len) {
+			len = rowlen - pos;
+			if(len > display->chunk - total) {
+				len = display->chunk - total;
+			}
+			xfers[n].tx = &row[pos];
+			xfers[n].len = (unsigned int)len;
+			total += len;
+			n++;
+			if(total == display->chunk || n == DISPLAY_MAX_SEGMENTS) {
+				if(wiringXSPITransfer(display->config.channel, xfers, n) < 0) {
+					return -1;
+				}
+				n = 0;
+				total = 0;
+			}
+		}
+	}
+	if(n > 0 && wiringXSPITransfer(display->config.channel, xfers, n) < 0) {
+		return -1;
+	}
+	display->stats.bytes += rowlen * (size_t)(rect->y1 - rect->y0 + 1);
+
+	return 0;
+}
+
+/*
+ * Turns the per row dirty spans into rectangles.
+ * A dirty row joins the rectangle above it when the
+ * bigger union costs less than a separate window.
+ */
+static int display_coalesce(struct wiringXDisplay_t *display) {
+	struct display_rect_t *cur = NULL;
+	long merged = 0, apart = 0;
+	int y = 0, x0 = 0, x1 = 0, nr = 0;
+
+	for(y=0;y<display->config.height;y++) {
+		if(display->span[y*2] < 0) {
+			cur = NULL;
+			continue;
+		}
+		x0 = display->span[y*2];
+		x1 = display->span[y*2+1];
+		if(cur != NULL) {
+			int ux0 = (x0 < cur->x0) ? x0 : cur->x0;
+			int ux1 = (x1 > cur->x1) ? x1 : cur->x1;
+			merged = (long)(ux1 - ux0 + 1) * (cur->y1 - cur->y0 + 2) * 2;
+			apart = (long)(cur->x1 - cur->x0 + 1) * (cur->y1 - cur->y0 + 1) * 2
+				+ (long)(x1 - x0 + 1) * 2 + DISPLAY_RECT_COST;
+			if(merged <= apart) {
+				cur->x0 = ux0;
+				cur->x1 = ux1;
+				cur->y1 = y;
+				continue;
+			}
+		}
+		cur = &display->rects[nr++];
+		cur->x0 = x0;
+		cur->x1 = x1;
+		cur->y0 = y;
+		cur->y1 = y;
+	}
+	return nr;
+}
+
+static size_t display_spidev_bufsiz(void) {
+	unsigned long size = 0;
+	FILE *fp = NULL;
+
+	if((fp = fopen("/sys/module/spidev/parameters/bufsiz", "r")) != NULL) {
+		if(fscanf(fp, "%lu", &size) != 1) {
+			size = 0;
+		}
+		fclose(fp);
+	}
+	if(size == 0) {
+		size = 4096;
+	}
+	return (size_t)size;
+}
+
+EXPORT struct wiringXDisplay_t *wiringXDisplaySetup(struct wiringXDisplayConfig_t *config) {
+	struct wiringXDisplay_t *display = NULL;
+	unsigned char data[1];
+
+	if(config->width <= 0 || config->height <= 0) {
+		wiringXLog(LOG_ERR, "wiringX display needs a width and height above zero");
+		return NULL;
+	}
+	if(pinMode(config->dc_pin, PINMODE_OUTPUT) < 0) {
+		return NULL;
+	}
+
+	if((display = malloc(sizeof(struct wiringXDisplay_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(display, 0, sizeof(struct wiringXDisplay_t));
+	memcpy(&display->config, config, sizeof(struct wiringXDisplayConfig_t));
+
+	display->stride = (size_t)config->width * 2;
+	display->chunk = display_spidev_bufsiz();
+
+	if((display->previous = malloc(display->stride * (size_t)config->height)) == NULL ||
+		 (display->span = malloc(sizeof(int) * 2 * (size_t)config->height)) == NULL ||
+		 (display->rects = malloc(sizeof(struct display_rect_t) * (size_t)config->height)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+
+	if(display_command(display, ST7789_SWRESET, NULL, 0) < 0) {
+		wiringXDisplayGC(display);
+		return NULL;
+	}
+	delayMicroseconds(150000);
+	display_command(display, ST7789_SLPOUT, NULL, 0);
+	delayMicroseconds(10000);
+	data[0] = 0x55; /* 16 bits per pixel */
+	display_command(display, ST7789_COLMOD, data, 1);
+	data[0] = (unsigned char)config->madctl;
+	display_command(display, ST7789_MADCTL, data, 1);
+	display_command(display, ST7789_INVON, NULL, 0);
+	display_command(display, ST7789_NORON, NULL, 0);
+	if(display_command(display, ST7789_DISPON, NULL, 0) < 0) {
+		wiringXDisplayGC(display);
+		return NULL;
+	}
+
+	return display;
+}
+
+/*
+ * The frame holds width*height big endian RGB565
+ * pixels, which is the panel's own byte order.
+ */
+EXPORT int wiringXDisplayPush(struct wiringXDisplay_t *display, const unsigned char *frame) {
+	struct display_rect_t *rect = NULL;
+	const unsigned char *a = NULL, *b = NULL;
+	int y = 0, first = 0, last = 0, nr = 0, i = 0;
+	size_t offs = 0, len = 0;
+
+	if(display->valid == 0) {
+		for(y=0;y<display->config.height;y++) {
+			display->span[y*2] = 0;
+			display->span[y*2+1] = display->config.width-1;
+		}
+	} else {
+		for(y=0;y<display->config.height;y++) {
+			a = &frame[(size_t)y * display->stride];
+			b = &display->previous[(size_t)y * display->stride];
+			if((first = display_first_diff(a, b, (int)display->stride)) < 0) {
+				display->span[y*2] = -1;
+				continue;
+			}
+			last = display_last_diff(a, b, (int)display->stride);
+			display->span[y*2] = first / 2;
+			display->span[y*2+1] = last / 2;
+		}
+	}
+
+	nr = display_coalesce(display);
+	for(i=0;i<nr;i++) {
+		rect = &display->rects[i];
+		if(display_send_rect(display, frame, rect) < 0) {
+			display->valid = 0;
+			return -1;
+		}
+		len = (size_t)(rect->x1 - rect->x0 + 1) * 2;
+		for(y=rect->y0;y<=rect->y1;y++) {
+			offs = (size_t)y * display->stride + (size_t)rect->x0 * 2;
+			memcpy(&display->previous[offs], &frame[offs], len);
+		}
+	}
+
+	display->valid = 1;
+	display->stats.frames++;
+	display->stats.rects += (uint64_t)nr;
+	display->stats.full_bytes += display->stride * (size_t)display->config.height;
+
+	return nr;
+}
+
+EXPORT void wiringXDisplayInvalidate(struct wiringXDisplay_t *display) {
+	display->valid = 0;
+}
+
+EXPORT int wiringXDisplayStats(struct wiringXDisplay_t *display, struct wiringXDisplayStats_t *stats) {
+	if(display == NULL) {
+		return -1;
+	}
+	memcpy(stats, &display->stats, sizeof(struct wiringXDisplayStats_t));
+	return 0;
+}
+
+EXPORT void wiringXDisplayGC(struct wiringXDisplay_t *display) {
+	if(display == NULL) {
+		return;
+	}
+	free(display->previous);
+	free(display->span);
+	free(display->rects);
+	free(display);
+}
+
+#endif
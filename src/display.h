@@ -0,0 +1,54 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_DISPLAY_H_
+#define _WIRINGX_DISPLAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "wiringx.h"
+
+typedef struct wiringXDisplayConfig_t {
+	/* SPI channel that has already been setup */
+	int channel;
+	/* GPIO driving the panel data / command line */
+	int dc_pin;
+	int width;
+	int height;
+	/* Panel RAM offset of the visible area */
+	int x_offset;
+	int y_offset;
+	/* MADCTL value, 0 keeps the default orientation */
+	int madctl;
+} wiringXDisplayConfig_t;
+
+typedef struct wiringXDisplayStats_t {
+	uint64_t frames;
+	uint64_t rects;
+	/* Pixel bytes sent versus what full frames would have cost */
+	uint64_t bytes;
+	uint64_t full_bytes;
+} wiringXDisplayStats_t;
+
+struct wiringXDisplay_t;
+
+struct wiringXDisplay_t *wiringXDisplaySetup(struct wiringXDisplayConfig_t *);
+int wiringXDisplayPush(struct wiringXDisplay_t *, const unsigned char *frame);
+void wiringXDisplayInvalidate(struct wiringXDisplay_t *);
+int wiringXDisplayStats(struct wiringXDisplay_t *, struct wiringXDisplayStats_t *);
+void wiringXDisplayGC(struct wiringXDisplay_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,458 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "wiringx.h"
+#include "framer.h"
+
+#define SLIP_END			0xC0
+#define SLIP_ESC			0xDB
+#define SLIP_ESC_END	0xDC
+#define SLIP_ESC_ESC	0xDD
+
+#define COBS_BLOCK		254
+
+typedef struct wiringXFramer_t {
+	struct wiringXFramerConfig_t config;
+	unsigned char delimiter;
+
+	/*
+	 * Bytes before start were handed out already,
+	 * bytes between start and scan were searched
+	 * for a delimiter, end is where new data goes.
+	 */
+	unsigned char *buffer;
+	size_t size;
+	size_t start;
+	size_t scan;
+	size_t end;
+	/* Skipping the rest of a frame that did not fit */
+	int discard;
+
+	struct wiringXFramerStats_t stats;
+} wiringXFramer_t;
+
+EXPORT struct wiringXFramer_t *wiringXFramerSetup(struct wiringXFramerConfig_t *config) {
+	struct wiringXFramer_t *framer = NULL;
+
+	switch(config->type) {
+		case FRAMER_DELIMITER:
+		case FRAMER_COBS:
+		case FRAMER_SLIP:
+		break;
+		case FRAMER_LENGTH:
+			if(config->length_bytes != 1 && config->length_bytes != 2 && config->length_bytes != 4) {
+				wiringXLog(LOG_ERR, "wiringX framer can not handle a %d byte length header", config->length_bytes);
+				return NULL;
+			}
+		break;
+		default:
+			wiringXLog(LOG_ERR, "wiringX framer can not handle type %d", config->type);
+		return NULL;
+	}
+
+	if((framer = malloc(sizeof(struct wiringXFramer_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(framer, 0, sizeof(struct wiringXFramer_t));
+	memcpy(&framer->config, config, sizeof(struct wiringXFramerConfig_t));
+
+	framer->size = (config->max_frame == 0) ? 4096 : config->max_frame;
+	if((framer->buffer = malloc(framer->size)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+
+	switch(config->type) {
+		case FRAMER_COBS:
+			framer->delimiter = 0x00;
+		break;
+		case FRAMER_SLIP:
+			framer->delimiter = SLIP_END;
+		break;
+		default:
+			framer->delimiter = config->delimiter;
+		break;
+	}
+
+	return framer;
+}
+
+/* Returns the decoded length or -1 for a malformed frame */
+static int framer_cobs_decode(unsigned char *buf, size_t len) {
+	size_t r = 0, w = 0, code = 0;
+
+	while(r < len) {
+		code = buf[r++];
+		if(code == 0 || r + code - 1 > len) {
+			return -1;
+		}
+		memmove(&buf[w], &buf[r], code - 1);
+		w += code - 1;
+		r += code - 1;
+		if(code < 0xFF && r < len) {
+			buf[w++] = 0x00;
+		}
+	}
+
+	return (int)w;
+}
+
+static int framer_slip_decode(unsigned char *buf, size_t len) {
+	unsigned char *p = NULL;
+	size_t r = 0, w = 0, run = 0;
+
+	/* Escapes are rare, so copy the runs in between at once */
+	while(r < len) {
+		p = memchr(&buf[r], SLIP_ESC, len - r);
+		run = (p == NULL) ? len - r : (size_t)(p - &buf[r]);
+		if(w != r) {
+			memmove(&buf[w], &buf[r], run);
+		}
+		w += run;
+		r += run;
+		if(p == NULL) {
+			break;
+		}
+		if(r + 1 >= len) {
+			return -1;
+		}
+		switch(buf[r+1]) {
+			case SLIP_ESC_END:
+				buf[w++] = SLIP_END;
+			break;
+			case SLIP_ESC_ESC:
+				buf[w++] = SLIP_ESC;
+			break;
+			default:
+			return -1;
+		}
+		r += 2;
+	}
+
+	return (int)w;
+}
+
+/* Moves unread data to the front to make room at the end */
+static void framer_compact(struct wiringXFramer_t *framer) {
+	if(framer->start == 0) {
+		return;
+	}
+	memmove(framer->buffer, &framer->buffer[framer->start], framer->end - framer->start);
+	framer->scan -= framer->start;
+	framer->end -= framer->start;
+	framer->start = 0;
+}
+
+/*
+ * Returns the free space at the end of the receive
+ * buffer, so data can be read straight into it and
+ * committed afterwards. This invalidates earlier
+ * frame views.
+ */
+EXPORT unsigned char *wiringXFramerBuffer(struct wiringXFramer_t *framer, size_t *space) {
+	framer_compact(framer);
+
+	if(framer->end == framer->size) {
+		/*
+		 * The caller has to take the frames that are
+		 * still in there first. A length header larger
+		 * than the buffer is already rejected by Next.
+		 */
+		if(framer->config.type == FRAMER_LENGTH || memchr(&framer->buffer[framer->scan], framer->delimiter, framer->end - framer->scan) != NULL) {
+			*space = 0;
+			return &framer->buffer[framer->end];
+		}
+		/* A frame that does not fit, drop it up to the next delimiter */
+		framer->discard = 1;
+		framer->stats.errors++;
+		framer->start = 0;
+		framer->scan = 0;
+		framer->end = 0;
+	}
+
+	*space = framer->size - framer->end;
+	return &framer->buffer[framer->end];
+}
+
+EXPORT int wiringXFramerCommit(struct wiringXFramer_t *framer, size_t len) {
+	if(len > framer->size - framer->end) {
+		return -1;
+	}
+	framer->end += len;
+	framer->stats.bytes += len;
+	return 0;
+}
+
+/* Returns how many bytes were copied, call Next to make more room */
+EXPORT int wiringXFramerFeed(struct wiringXFramer_t *framer, const void *data, size_t len) {
+	unsigned char *ptr = NULL;
+	size_t space = 0;
+
+	ptr = wiringXFramerBuffer(framer, &space);
+	if(len > space) {
+		len = space;
+	}
+	memcpy(ptr, data, len);
+	wiringXFramerCommit(framer, len);
+
+	return (int)len;
+}
+
+/*
+ * Waits up to timeout milliseconds for data and then
+ * reads everything the port has buffered straight
+ * into the framer.
+ */
+EXPORT int wiringXFramerRead(struct wiringXFramer_t *framer, int fd, int timeout) {
+	struct pollfd pfd;
+	unsigned char *ptr = NULL;
+	size_t space = 0;
+	int ret = 0;
+
+	ptr = wiringXFramerBuffer(framer, &space);
+	if(space == 0) {
+		return 0;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	while((ret = poll(&pfd, 1, timeout)) < 0 && errno == EINTR);
+	if(ret <= 0) {
+		return ret;
+	}
+
+	if((ret = wiringXSerialRead(fd, ptr, space, 0)) > 0) {
+		wiringXFramerCommit(framer, (size_t)ret);
+	}
+	return ret;
+}
+
+static int framer_next_delimited(struct wiringXFramer_t *framer, struct wiringXFrame_t *frame) {
+	unsigned char *p = NULL, *data = NULL;
+	size_t len = 0;
+	int ret = 0;
+
+	while(framer->scan < framer->end) {
+		if((p = memchr(&framer->buffer[framer->scan], framer->delimiter, framer->end - framer->scan)) == NULL) {
+			framer->scan = framer->end;
+			return 0;
+		}
+
+		data = &framer->buffer[framer->start];
+		len = (size_t)(p - data);
+		framer->start = framer->scan = (size_t)(p - framer->buffer) + 1;
+
+		if(framer->discard == 1) {
+			framer->discard = 0;
+			continue;
+		}
+		/* Back to back delimiters are used to resynchronise */
+		if(len == 0) {
+			continue;
+		}
+
+		switch(framer->config.type) {
+			case FRAMER_COBS:
+				ret = framer_cobs_decode(data, len);
+			break;
+			case FRAMER_SLIP:
+				ret = framer_slip_decode(data, len);
+			break;
+			default:
+				ret = (int)len;
+			break;
+		}
+		if(ret < 0) {
+			framer->stats.errors++;
+			continue;
+		}
+
+		frame->data = data;
+		frame->len = (size_t)ret;
+		framer->stats.frames++;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int framer_next_length(struct wiringXFramer_t *framer, struct wiringXFrame_t *frame) {
+	unsigned char *p = &framer->buffer[framer->start];
+	size_t avail = framer->end - framer->start, len = 0;
+	int hdr = framer->config.length_bytes, i = 0;
+
+	if(avail < (size_t)hdr) {
+		return 0;
+	}
+	for(i=0;i<hdr;i++) {
+		if(framer->config.big_endian == 1) {
+			len = (len << 8) | p[i];
+		} else {
+			len |= (size_t)p[i] << (8*i);
+		}
+	}
+
+	/* There is no way to find the next frame, so start over */
+	if(len > framer->size - (size_t)hdr) {
+		framer->stats.errors++;
+		framer->start = framer->scan = framer->end = 0;
+		return 0;
+	}
+	if(avail < (size_t)hdr + len) {
+		return 0;
+	}
+
+	frame->data = &p[hdr];
+	frame->len = len;
+	framer->start += (size_t)hdr + len;
+	framer->scan = framer->start;
+	framer->stats.frames++;
+
+	return 1;
+}
+
+/* Returns 1 and a view of the next frame, or 0 when there is none yet */
+EXPORT int wiringXFramerNext(struct wiringXFramer_t *framer, struct wiringXFrame_t *frame) {
+	if(framer == NULL) {
+		return -1;
+	}
+	if(framer->config.type == FRAMER_LENGTH) {
+		return framer_next_length(framer, frame);
+	}
+	return framer_next_delimited(framer, frame);
+}
+
+static int framer_cobs_encode(const unsigned char *in, size_t len, unsigned char *out, size_t size) {
+	const unsigned char *p = NULL;
+	size_t r = 0, w = 0, max = 0, run = 0;
+	int zero = 1;
+
+	if(size < len + len/COBS_BLOCK + 2) {
+		return -1;
+	}
+
+	/* An empty input or a trailing zero still needs a final block */
+	while(r < len || zero == 1) {
+		max = len - r;
+		if(max > COBS_BLOCK) {
+			max = COBS_BLOCK;
+		}
+		p = (max > 0) ? memchr(&in[r], 0x00, max) : NULL;
+		run = (p == NULL) ? max : (size_t)(p - &in[r]);
+
+		out[w++] = (unsigned char)(run + 1);
+		memcpy(&out[w], &in[r], run);
+		w += run;
+		r += run;
+
+		zero = 0;
+		if(p != NULL) {
+			r++;
+			zero = 1;
+		}
+	}
+	out[w++] = 0x00;
+
+	return (int)w;
+}
+
+static int framer_slip_encode(const unsigned char *in, size_t len, unsigned char *out, size_t size) {
+	size_t r = 0, w = 0;
+
+	if(size < len*2 + 2) {
+		return -1;
+	}
+
+	out[w++] = SLIP_END;
+	for(r=0;r<len;r++) {
+		switch(in[r]) {
+			case SLIP_END:
+				out[w++] = SLIP_ESC;
+				out[w++] = SLIP_ESC_END;
+			break;
+			case SLIP_ESC:
+				out[w++] = SLIP_ESC;
+				out[w++] = SLIP_ESC_ESC;
+			break;
+			default:
+				out[w++] = in[r];
+			break;
+		}
+	}
+	out[w++] = SLIP_END;
+
+	return (int)w;
+}
+
+/*
+ * Encodes a payload into a complete frame ready
+ * to be written, returns its length or -1 when
+ * it does not fit into size bytes.
+ */
+EXPORT int wiringXFramerEncode(struct wiringXFramer_t *framer, const void *in, size_t len, void *out, size_t size) {
+	unsigned char *o = out;
+	int hdr = 0, i = 0;
+
+	if(framer == NULL) {
+		return -1;
+	}
+
+	switch(framer->config.type) {
+		case FRAMER_COBS:
+			return framer_cobs_encode(in, len, out, size);
+		case FRAMER_SLIP:
+			return framer_slip_encode(in, len, out, size);
+		case FRAMER_DELIMITER:
+			if(size < len + 1 || memchr(in, framer->delimiter, len) != NULL) {
+				return -1;
+			}
+			memcpy(o, in, len);
+			o[len] = framer->delimiter;
+			return (int)(len + 1);
+		case FRAMER_LENGTH:
+			hdr = framer->config.length_bytes;
+			if(size < (size_t)hdr + len || (hdr < 4 && len >= (1UL << (8*hdr)))) {
+				return -1;
+			}
+			for(i=0;i<hdr;i++) {
+				if(framer->config.big_endian == 1) {
+					o[i] = (unsigned char)(len >> (8*(hdr-1-i)));
+				} else {
+					o[i] = (unsigned char)(len >> (8*i));
+				}
+			}
+			memcpy(&o[hdr], in, len);
+			return (int)(hdr + len);
+	}
+
+	return -1;
+}
+
+EXPORT int wiringXFramerStats(struct wiringXFramer_t *framer, struct wiringXFramerStats_t *stats) {
+	if(framer == NULL) {
+		return -1;
+	}
+	memcpy(stats, &framer->stats, sizeof(struct wiringXFramerStats_t));
+	return 0;
+}
+
+EXPORT void wiringXFramerGC(struct wiringXFramer_t *framer) {
+	if(framer == NULL) {
+		return;
+	}
+	free(framer->buffer);
+	free(framer);
+}
@@ -0,0 +1,73 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_FRAMER_H_
+#define _WIRINGX_FRAMER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wiringx.h"
+
+enum framer_type_t {
+	/* Frames end with a delimiter byte, e.g. '\n' */
+	FRAMER_DELIMITER = 0,
+	/* Consistent overhead byte stuffing, frames end with 0x00 */
+	FRAMER_COBS = 1,
+	/* RFC 1055, frames end with 0xC0 */
+	FRAMER_SLIP = 2,
+	/* A 1, 2 or 4 byte length header followed by the payload */
+	FRAMER_LENGTH = 3
+};
+
+typedef struct wiringXFramerConfig_t {
+	enum framer_type_t type;
+	unsigned char delimiter;
+	int length_bytes;
+	int big_endian;
+	/* Receive buffer size and thus the largest frame, 0 selects 4096 */
+	size_t max_frame;
+} wiringXFramerConfig_t;
+
+/*
+ * Points into the receive buffer of the framer and
+ * stays valid until the next Feed, Buffer or Read.
+ */
+typedef struct wiringXFrame_t {
+	const unsigned char *data;
+	size_t len;
+} wiringXFrame_t;
+
+typedef struct wiringXFramerStats_t {
+	uint64_t bytes;
+	uint64_t frames;
+	/* Frames that could not be decoded or did not fit */
+	uint64_t errors;
+} wiringXFramerStats_t;
+
+struct wiringXFramer_t;
+
+struct wiringXFramer_t *wiringXFramerSetup(struct wiringXFramerConfig_t *);
+unsigned char *wiringXFramerBuffer(struct wiringXFramer_t *, size_t *space);
+int wiringXFramerCommit(struct wiringXFramer_t *, size_t len);
+int wiringXFramerFeed(struct wiringXFramer_t *, const void *data, size_t len);
+int wiringXFramerRead(struct wiringXFramer_t *, int fd, int timeout);
+int wiringXFramerNext(struct wiringXFramer_t *, struct wiringXFrame_t *);
+int wiringXFramerEncode(struct wiringXFramer_t *, const void *in, size_t len, void *out, size_t size);
+int wiringXFramerStats(struct wiringXFramer_t *, struct wiringXFramerStats_t *);
+void wiringXFramerGC(struct wiringXFramer_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
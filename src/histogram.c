@@ -0,0 +1,108 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <string.h>
+
+#include "histogram.h"
+
+static int histogram_bucket(uint64_t value) {
+	int msb = 0;
+
+	if(value < HISTOGRAM_SUB) {
+		return (int)value;
+	}
+	msb = 63 - __builtin_clzll(value);
+
+	return (msb - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB +
+		(int)((value >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB - 1));
+}
+
+/*
+ * Counting is safe from several threads at once.
+ * It is a single atomic add, the total is summed
+ * from the buckets when reading.
+ */
+void histogram_add(struct histogram_t *histogram, uint64_t value) {
+	uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+
+	__atomic_add_fetch(&histogram->counts[histogram_bucket(value)], 1, __ATOMIC_RELAXED);
+
+	while(value > max) {
+		if(__atomic_compare_exchange_n(&histogram->max, &max, value, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+			break;
+		}
+	}
+}
+
+/* Highest value that is counted in a bucket */
+uint64_t histogram_value(int bucket) {
+	int shift = 0;
+
+	if(bucket < 2*HISTOGRAM_SUB) {
+		return (uint64_t)bucket;
+	}
+	shift = bucket / HISTOGRAM_SUB - 1;
+
+	return ((uint64_t)(HISTOGRAM_SUB + bucket % HISTOGRAM_SUB) << shift) + ((1ULL << shift) - 1);
+}
+
+uint64_t histogram_count(struct histogram_t *histogram) {
+	uint64_t total = 0;
+	int i = 0;
+
+	for(i=0;i<HISTOGRAM_BUCKETS;i++) {
+		total += __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+	}
+	return total;
+}
+
+uint64_t histogram_percentile(struct histogram_t *histogram, double percentile) {
+	uint64_t total = histogram_count(histogram);
+	uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+	uint64_t rank = 0, seen = 0, value = 0;
+	int i = 0;
+
+	if(total == 0) {
+		return 0;
+	}
+	rank = (uint64_t)((double)total * percentile / 100.0 + 0.5);
+	if(rank == 0) {
+		rank = 1;
+	}
+
+	for(i=0;i<HISTOGRAM_BUCKETS;i++) {
+		seen += __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+		if(seen >= rank) {
+			break;
+		}
+	}
+	if(i == HISTOGRAM_BUCKETS) {
+		return max;
+	}
+
+	/* The bucket bound may lie past the largest value seen */
+	value = histogram_value(i);
+	return (value > max) ? max : value;
+}
+
+/* Adds the counts of src to dst, dst must not be counted into meanwhile */
+void histogram_merge(struct histogram_t *dst, struct histogram_t *src) {
+	uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+	int i = 0;
+
+	for(i=0;i<HISTOGRAM_BUCKETS;i++) {
+		dst->counts[i] += __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+	}
+	if(max > dst->max) {
+		dst->max = max;
+	}
+}
+
+void histogram_reset(struct histogram_t *histogram) {
+	memset(histogram, 0, sizeof(struct histogram_t));
+}
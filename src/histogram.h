@@ -0,0 +1,36 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_HISTOGRAM_H_
+#define _WIRINGX_HISTOGRAM_H_
+
+#include <stdint.h>
+
+/*
+ * Log-linear histogram of 64 bit values. Every
+ * power of two is split in 16 linear buckets, so
+ * a bucket is never more than 1/16th off from the
+ * values it counts. Values below 32 are exact.
+ */
+#define HISTOGRAM_SUB_BITS	4
+#define HISTOGRAM_SUB				(1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS		((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB)
+
+typedef struct histogram_t {
+	uint64_t counts[HISTOGRAM_BUCKETS];
+	uint64_t max;
+} histogram_t;
+
+void histogram_add(struct histogram_t *, uint64_t value);
+uint64_t histogram_value(int bucket);
+uint64_t histogram_count(struct histogram_t *);
+uint64_t histogram_percentile(struct histogram_t *, double percentile);
+void histogram_merge(struct histogram_t *, struct histogram_t *);
+void histogram_reset(struct histogram_t *);
+
+#endif
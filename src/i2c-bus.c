@@ -0,0 +1,399 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "wiringx.h"
+#include "stats.h"
+#include "i2c-dev.h"
+
+/*
+ * A request waits in the bus queue until a thread
+ * holding the bus executes it. The first thread to
+ * find the bus idle drains the whole queue, so
+ * concurrent callers are served in order with a
+ * single lock handover per batch.
+ */
+typedef struct i2c_request_t {
+	struct i2c_msg *msgs;
+	int nmsgs;
+	int result;
+	int done;
+	struct i2c_request_t *next;
+} i2c_request_t;
+
+/*
+ * opens counts wiringXI2CBusOpen handles, refs those
+ * plus every call still using the bus. A closed bus
+ * keeps its slot until the last call is done with it.
+ */
+typedef struct i2c_bus_t {
+	char path[PATH_MAX];
+	int fd;
+	int slot;
+	int opens;
+	int refs;
+	int coalesce;
+
+	pthread_mutex_t lock;
+	pthread_cond_t signal;
+	int active;
+	struct i2c_request_t *head;
+	struct i2c_request_t *tail;
+
+	struct wiringXI2CBusStats_t stats;
+} i2c_bus_t;
+
+static struct i2c_bus_t **buses = NULL;
+static int nrbuses = 0;
+static pthread_mutex_t buslock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Every successful i2c_bus_get needs an i2c_bus_put */
+static struct i2c_bus_t *i2c_bus_get(int bus) {
+	struct i2c_bus_t *tmp = NULL;
+
+	pthread_mutex_lock(&buslock);
+	if(bus >= 0 && bus < nrbuses && buses[bus] != NULL && buses[bus]->opens > 0) {
+		tmp = buses[bus];
+		tmp->refs++;
+	}
+	pthread_mutex_unlock(&buslock);
+
+	if(tmp == NULL) {
+		wiringXLog(LOG_ERR, "wiringX I2C bus %d has not been opened", bus);
+	}
+	return tmp;
+}
+
+static void i2c_bus_put(struct i2c_bus_t *bus) {
+	pthread_mutex_lock(&buslock);
+	if(--bus->refs > 0) {
+		pthread_mutex_unlock(&buslock);
+		return;
+	}
+	/* Nobody holds a reference, so nothing is queued either */
+	buses[bus->slot] = NULL;
+	pthread_mutex_unlock(&buslock);
+
+	close(bus->fd);
+	pthread_mutex_destroy(&bus->lock);
+	pthread_cond_destroy(&bus->signal);
+	free(bus);
+}
+
+EXPORT int wiringXI2CBusOpen(const char *path) {
+	struct i2c_bus_t *tmp = NULL;
+	int i = 0, fd = 0, slot = -1;
+
+	pthread_mutex_lock(&buslock);
+	for(i=0;i<nrbuses;i++) {
+		if(buses[i] == NULL) {
+			if(slot == -1) {
+				slot = i;
+			}
+		} else if(buses[i]->opens > 0 && strcmp(buses[i]->path, path) == 0) {
+			buses[i]->opens++;
+			buses[i]->refs++;
+			pthread_mutex_unlock(&buslock);
+			return i;
+		}
+	}
+
+	if((fd = open(path, O_RDWR)) < 0) {
+		pthread_mutex_unlock(&buslock);
+		wiringXLog(LOG_ERR, "wiringX failed to open %s for reading and writing (%s)", path, strerror(errno));
+		return -1;
+	}
+
+	if((tmp = malloc(sizeof(struct i2c_bus_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(tmp, 0, sizeof(struct i2c_bus_t));
+	snprintf(tmp->path, sizeof(tmp->path), "%s", path);
+	tmp->fd = fd;
+	tmp->opens = 1;
+	tmp->refs = 1;
+	pthread_mutex_init(&tmp->lock, NULL);
+	pthread_cond_init(&tmp->signal, NULL);
+
+	if(slot == -1) {
+		if((buses = realloc(buses, sizeof(struct i2c_bus_t *)*(nrbuses+1))) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		slot = nrbuses++;
+	}
+	tmp->slot = slot;
+	buses[slot] = tmp;
+	pthread_mutex_unlock(&buslock);
+
+	return slot;
+}
+
+EXPORT int wiringXI2CBusClose(int bus) {
+	struct i2c_bus_t *tmp = NULL;
+
+	pthread_mutex_lock(&buslock);
+	if(bus < 0 || bus >= nrbuses || buses[bus] == NULL || buses[bus]->opens == 0) {
+		pthread_mutex_unlock(&buslock);
+		return -1;
+	}
+	tmp = buses[bus];
+	tmp->opens--;
+	pthread_mutex_unlock(&buslock);
+
+	i2c_bus_put(tmp);
+
+	return 0;
+}
+
+/*
+ * With coalescing enabled queued requests are packed
+ * into a single I2C_RDWR, so devices see a repeated
+ * start instead of a stop between them. Leave it off
+ * for devices that act on the stop, such as EEPROMs.
+ * When a packed transfer fails every request in it
+ * fails, none is replayed as the ones before the
+ * failing message may already have been executed.
+ */
+EXPORT int wiringXI2CBusCoalesce(int bus, int enable) {
+	struct i2c_bus_t *tmp = NULL;
+
+	if((tmp = i2c_bus_get(bus)) == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&tmp->lock);
+	tmp->coalesce = (enable != 0);
+	pthread_mutex_unlock(&tmp->lock);
+	i2c_bus_put(tmp);
+
+	return 0;
+}
+
+static void i2c_bus_count(int fd, struct i2c_request_t *req) {
+#ifndef WIRINGX_NO_STATS
+	size_t tx = 0, rx = 0;
+	int i = 0;
+
+	for(i=0;i<req->nmsgs;i++) {
+		if((req->msgs[i].flags & I2C_M_RD) == I2C_M_RD) {
+			rx += req->msgs[i].len;
+		} else {
+			tx += req->msgs[i].len;
+		}
+	}
+	STATS_I2C(fd, req->result, tx, rx);
+#endif
+}
+
+static void i2c_bus_execute(int fd, struct i2c_request_t *batch, int coalesce, struct wiringXI2CBusStats_t *stats) {
+	struct i2c_msg msgs[I2C_RDWR_MAX_MSGS];
+	struct i2c_request_t *req = NULL, *end = NULL;
+	int n = 0, count = 0, ret = 0;
+
+	while(batch != NULL) {
+		n = 0;
+		count = 0;
+		end = batch;
+		if(coalesce == 1) {
+			while(end != NULL && n + end->nmsgs <= I2C_RDWR_MAX_MSGS) {
+				memcpy(&msgs[n], end->msgs, sizeof(struct i2c_msg)*end->nmsgs);
+				n += end->nmsgs;
+				count++;
+				end = end->next;
+			}
+		}
+
+		if(count > 1) {
+			stats->ioctls++;
+			if((ret = i2c_rdwr(fd, msgs, n)) < 0) {
+				stats->errors += (uint64_t)count;
+			} else {
+				stats->coalesced += (uint64_t)(count - 1);
+			}
+			for(req=batch;req!=end;req=req->next) {
+				req->result = (ret < 0) ? -1 : 0;
+				i2c_bus_count(fd, req);
+			}
+			batch = end;
+			continue;
+		} else {
+			end = batch->next;
+		}
+
+		for(req=batch;req!=end;req=req->next) {
+			stats->ioctls++;
+			if((req->result = i2c_rdwr(fd, req->msgs, req->nmsgs)) < 0) {
+				req->result = -1;
+				stats->errors++;
+			} else {
+				req->result = 0;
+			}
+			i2c_bus_count(fd, req);
+		}
+		batch = end;
+	}
+}
+
+static int i2c_bus_submit(struct i2c_bus_t *bus, struct i2c_msg *msgs, int nmsgs) {
+	struct i2c_request_t req, *batch = NULL, *tmp = NULL;
+	struct wiringXI2CBusStats_t stats;
+	int coalesce = 0;
+
+	req.msgs = msgs;
+	req.nmsgs = nmsgs;
+	req.result = -1;
+	req.done = 0;
+	req.next = NULL;
+
+	pthread_mutex_lock(&bus->lock);
+	if(bus->tail == NULL) {
+		bus->head = &req;
+	} else {
+		bus->tail->next = &req;
+	}
+	bus->tail = &req;
+	bus->stats.transfers++;
+
+	while(req.done == 0) {
+		if(bus->active == 1) {
+			pthread_cond_wait(&bus->signal, &bus->lock);
+			continue;
+		}
+
+		bus->active = 1;
+		batch = bus->head;
+		bus->head = NULL;
+		bus->tail = NULL;
+		coalesce = bus->coalesce;
+		pthread_mutex_unlock(&bus->lock);
+
+		memset(&stats, 0, sizeof(struct wiringXI2CBusStats_t));
+		i2c_bus_execute(bus->fd, batch, coalesce, &stats);
+
+		pthread_mutex_lock(&bus->lock);
+		bus->stats.ioctls += stats.ioctls;
+		bus->stats.coalesced += stats.coalesced;
+		bus->stats.errors += stats.errors;
+		while(batch != NULL) {
+			tmp = batch->next;
+			batch->done = 1;
+			batch = tmp;
+		}
+		bus->active = 0;
+		pthread_cond_broadcast(&bus->signal);
+	}
+	pthread_mutex_unlock(&bus->lock);
+
+	return req.result;
+}
+
+EXPORT int wiringXI2CBusTransfer(int bus, struct wiringXI2CMsg_t *msgs, int n) {
+	struct i2c_msg tmp[I2C_RDWR_MAX_MSGS];
+	struct i2c_bus_t *b = NULL;
+	int i = 0, ret = 0;
+
+	if(n <= 0 || n > I2C_RDWR_MAX_MSGS) {
+		wiringXLog(LOG_ERR, "wiringX cannot send %d I2C messages in one transfer", n);
+		return -1;
+	}
+	if((b = i2c_bus_get(bus)) == NULL) {
+		return -1;
+	}
+
+	for(i=0;i<n;i++) {
+		tmp[i].addr = msgs[i].addr;
+		tmp[i].flags = msgs[i].flags;
+		tmp[i].len = msgs[i].len;
+		tmp[i].buf = msgs[i].buf;
+	}
+
+	ret = i2c_bus_submit(b, tmp, n);
+	i2c_bus_put(b);
+
+	return ret;
+}
+
+EXPORT int wiringXI2CBusReadRegs(int bus, int addr, int reg, unsigned char *buf, int len) {
+	struct wiringXI2CMsg_t msgs[2];
+	unsigned char cmd = (unsigned char)reg;
+
+	if(len < 1 || len > I2C_RDWR_MAX_LEN) {
+		wiringXLog(LOG_ERR, "wiringX can read 1 to %d bytes in one I2C message", I2C_RDWR_MAX_LEN);
+		return -1;
+	}
+
+	msgs[0].addr = (unsigned short)addr;
+	msgs[0].flags = I2CMSG_WRITE;
+	msgs[0].len = 1;
+	msgs[0].buf = &cmd;
+
+	msgs[1].addr = (unsigned short)addr;
+	msgs[1].flags = I2CMSG_READ;
+	msgs[1].len = (unsigned short)len;
+	msgs[1].buf = buf;
+
+	return wiringXI2CBusTransfer(bus, msgs, 2);
+}
+
+EXPORT int wiringXI2CBusWriteRegs(int bus, int addr, int reg, const unsigned char *buf, int len) {
+	unsigned char stack[64], *tmp = stack;
+	struct wiringXI2CMsg_t msg;
+	int ret = 0;
+
+	if(len < 1 || len > I2C_RDWR_MAX_LEN - 1) {
+		wiringXLog(LOG_ERR, "wiringX can write 1 to %d bytes after the register in one I2C message", I2C_RDWR_MAX_LEN - 1);
+		return -1;
+	}
+	if(len+1 > (int)sizeof(stack)) {
+		if((tmp = malloc(len+1)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+	}
+	tmp[0] = (unsigned char)reg;
+	memcpy(&tmp[1], buf, len);
+
+	msg.addr = (unsigned short)addr;
+	msg.flags = I2CMSG_WRITE;
+	msg.len = (unsigned short)(len+1);
+	msg.buf = tmp;
+
+	ret = wiringXI2CBusTransfer(bus, &msg, 1);
+
+	if(tmp != stack) {
+		free(tmp);
+	}
+	return ret;
+}
+
+EXPORT int wiringXI2CBusStats(int bus, struct wiringXI2CBusStats_t *stats) {
+	struct i2c_bus_t *tmp = NULL;
+
+	if((tmp = i2c_bus_get(bus)) == NULL) {
+		return -1;
+	}
+	pthread_mutex_lock(&tmp->lock);
+	memcpy(stats, &tmp->stats, sizeof(struct wiringXI2CBusStats_t));
+	pthread_mutex_unlock(&tmp->lock);
+	i2c_bus_put(tmp);
+
+	return 0;
+}
+
+#endif
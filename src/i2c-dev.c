@@ -70,4 +70,82 @@ extern inline __s32 i2c_smbus_write_word_data(int fd, int cmd, __u16 value) {
 	return i2c_smbus_access(fd, I2C_SMBUS_WRITE, cmd, I2C_SMBUS_WORD_DATA, &data);
 }
 
+/*
+ * SMBus block read, the device sends the length
+ * itself. Returns the number of bytes read.
+ */
+extern inline __s32 i2c_smbus_read_block_data(int fd, int cmd, __u8 *values) {
+	union i2c_smbus_data data;
+	int i = 0;
+
+	if(i2c_smbus_access(fd, I2C_SMBUS_READ, cmd, I2C_SMBUS_BLOCK_DATA, &data) < 0) {
+		return -1;
+	}
+	for(i=1;i<=data.block[0];i++) {
+		values[i-1] = data.block[i];
+	}
+	return data.block[0];
+}
+
+extern inline __s32 i2c_smbus_write_block_data(int fd, int cmd, __u8 length, const __u8 *values) {
+	union i2c_smbus_data data;
+	int i = 0;
+
+	if(length > I2C_SMBUS_BLOCK_MAX) {
+		length = I2C_SMBUS_BLOCK_MAX;
+	}
+	for(i=1;i<=length;i++) {
+		data.block[i] = values[i-1];
+	}
+	data.block[0] = length;
+
+	return i2c_smbus_access(fd, I2C_SMBUS_WRITE, cmd, I2C_SMBUS_BLOCK_DATA, &data);
+}
+
+/*
+ * Plain I2C block read of a fixed length, which
+ * most sensors without SMBus block support accept.
+ */
+extern inline __s32 i2c_smbus_read_i2c_block_data(int fd, int cmd, __u8 length, __u8 *values) {
+	union i2c_smbus_data data;
+	int i = 0;
+
+	if(length > I2C_SMBUS_BLOCK_MAX) {
+		length = I2C_SMBUS_BLOCK_MAX;
+	}
+	data.block[0] = length;
+
+	if(i2c_smbus_access(fd, I2C_SMBUS_READ, cmd, I2C_SMBUS_I2C_BLOCK_DATA, &data) < 0) {
+		return -1;
+	}
+	for(i=1;i<=data.block[0];i++) {
+		values[i-1] = data.block[i];
+	}
+	return data.block[0];
+}
+
+extern inline __s32 i2c_smbus_write_i2c_block_data(int fd, int cmd, __u8 length, const __u8 *values) {
+	union i2c_smbus_data data;
+	int i = 0;
+
+	if(length > I2C_SMBUS_BLOCK_MAX) {
+		length = I2C_SMBUS_BLOCK_MAX;
+	}
+	for(i=1;i<=length;i++) {
+		data.block[i] = values[i-1];
+	}
+	data.block[0] = length;
+
+	return i2c_smbus_access(fd, I2C_SMBUS_WRITE, cmd, I2C_SMBUS_I2C_BLOCK_DATA, &data);
+}
+
+extern inline __s32 i2c_rdwr(int fd, struct i2c_msg *msgs, int nmsgs) {
+	struct i2c_rdwr_ioctl_data args;
+
+	args.msgs = msgs;
+	args.nmsgs = nmsgs;
+
+	return ioctl(fd, I2C_RDWR, &args);
+}
+
 #endif
@@ -18,8 +18,14 @@
 #include <linux/i2c.h>
 
 #define I2C_SLAVE	0x0703
+#define I2C_RDWR	0x0707
 #define I2C_SMBUS	0x0720
 
+/* The kernel rejects I2C_RDWR calls with more messages */
+#define I2C_RDWR_MAX_MSGS	42
+/* i2c_msg.len is 16 bits wide */
+#define I2C_RDWR_MAX_LEN	65535
+
 struct i2c_smbus_ioctl_data {
 	__u8 read_write;
 	__u8 command;
@@ -27,6 +33,11 @@ struct i2c_smbus_ioctl_data {
 	union i2c_smbus_data *data;
 };
 
+struct i2c_rdwr_ioctl_data {
+	struct i2c_msg *msgs;
+	__u32 nmsgs;
+};
+
 inline __s32 i2c_smbus_access(int fd, char rw, int cmd, int size, union i2c_smbus_data *data);
 inline __s32 i2c_smbus_read_byte(int fd);
 inline __s32 i2c_smbus_write_byte(int fd, int value);
@@ -34,5 +45,10 @@ inline __s32 i2c_smbus_read_byte_data(int fd, int cmd);
 inline __s32 i2c_smbus_write_byte_data(int fd, int cmd, int value);
 inline __s32 i2c_smbus_read_word_data(int fd, int cmd);
 inline __s32 i2c_smbus_write_word_data(int fd, int cmd, __u16 value);
+inline __s32 i2c_smbus_read_block_data(int fd, int cmd, __u8 *values);
+inline __s32 i2c_smbus_write_block_data(int fd, int cmd, __u8 length, const __u8 *values);
+inline __s32 i2c_smbus_read_i2c_block_data(int fd, int cmd, __u8 length, __u8 *values);
+inline __s32 i2c_smbus_write_i2c_block_data(int fd, int cmd, __u8 length, const __u8 *values);
+inline __s32 i2c_rdwr(int fd, struct i2c_msg *msgs, int nmsgs);
 
 #endif
@@ -0,0 +1,460 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "wiringx.h"
+#include "ring.h"
+#include "i2c-poller.h"
+
+/*
+ * Every device read is a register write plus
+ * a read, I2C_RDWR takes at most 42 messages.
+ */
+#define I2C_POLLER_BATCH	21
+
+typedef struct i2c_poll_dev_t {
+	struct wiringXI2CPollConfig_t config;
+	struct ring_t ring;
+	unsigned char reg;
+	unsigned char buf[I2C_BLOCK_MAX];
+
+	uint64_t period;
+	uint64_t deadline;
+	uint32_t seq;
+	/* Read on its own since it was in a failed combined transfer */
+	int solo;
+
+	uint64_t latency;
+	struct wiringXI2CPollStats_t stats;
+} i2c_poll_dev_t;
+
+typedef struct i2c_poll_worker_t {
+	struct wiringXI2CPoller_t *poller;
+	int bus;
+	int ndevs;
+	struct i2c_poll_dev_t **devs;
+	pthread_t thread;
+} i2c_poll_worker_t;
+
+typedef struct wiringXI2CPoller_t {
+	uint64_t tick;
+	int priority;
+
+	int ndevs;
+	struct i2c_poll_dev_t **devs;
+	int nworkers;
+	struct i2c_poll_worker_t *workers;
+
+	pthread_mutex_t lock;
+	pthread_cond_t signal;
+	int running;
+} wiringXI2CPoller_t;
+
+static uint64_t i2c_poller_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Sleep until the deadline, returns 0 when
+ * the deadline passed or -1 when the poller
+ * is being stopped.
+ */
+static int i2c_poller_wait(struct wiringXI2CPoller_t *poller, uint64_t deadline) {
+	struct timespec ts;
+	int ret = 0;
+
+	ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+	ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+	pthread_mutex_lock(&poller->lock);
+	while(poller->running == 1 && ret != ETIMEDOUT) {
+		ret = pthread_cond_timedwait(&poller->signal, &poller->lock, &ts);
+	}
+	ret = (poller->running == 1) ? 0 : -1;
+	pthread_mutex_unlock(&poller->lock);
+
+	return ret;
+}
+
+static void i2c_poller_complete(struct i2c_poll_dev_t *dev, uint64_t timestamp, uint64_t done, int ok) {
+	struct wiringXI2CPollSample_t sample;
+	uint64_t late = 0, skip = 0;
+
+	late = (done > dev->deadline) ? done - dev->deadline : 0;
+	__atomic_add_fetch(&dev->latency, late, __ATOMIC_RELAXED);
+	if(late > dev->stats.max_latency_ns) {
+		__atomic_store_n(&dev->stats.max_latency_ns, late, __ATOMIC_RELAXED);
+	}
+
+	if(ok == 1) {
+		sample.timestamp = timestamp;
+		sample.seq = dev->seq++;
+		sample.len = (uint8_t)dev->config.len;
+		memcpy(sample.data, dev->buf, dev->config.len);
+		if(ring_push(&dev->ring, &sample, 1) == 0) {
+			__atomic_add_fetch(&dev->stats.dropped, 1, __ATOMIC_RELAXED);
+		}
+		__atomic_add_fetch(&dev->stats.reads, 1, __ATOMIC_RELAXED);
+	} else {
+		__atomic_add_fetch(&dev->stats.errors, 1, __ATOMIC_RELAXED);
+	}
+
+	/*
+	 * Stay on the original grid, periods that
+	 * already passed are counted and skipped.
+	 */
+	dev->deadline += dev->period;
+	if(done >= dev->deadline) {
+		skip = (done - dev->deadline) / dev->period + 1;
+		dev->deadline += skip * dev->period;
+		__atomic_add_fetch(&dev->stats.overruns, skip, __ATOMIC_RELAXED);
+	}
+}
+
+static void i2c_poller_msgs(struct wiringXI2CMsg_t *msgs, struct i2c_poll_dev_t *dev) {
+	msgs[0].addr = (unsigned short)dev->config.addr;
+	msgs[0].flags = I2CMSG_WRITE;
+	msgs[0].len = 1;
+	msgs[0].buf = &dev->reg;
+
+	msgs[1].addr = (unsigned short)dev->config.addr;
+	msgs[1].flags = I2CMSG_READ;
+	msgs[1].len = (unsigned short)dev->config.len;
+	msgs[1].buf = dev->buf;
+}
+
+/*
+ * A failed read is never repeated within its period,
+ * the reads before the failing message may already
+ * have emptied a FIFO or cleared a status register.
+ * Instead every device of a failed combined transfer
+ * is read on its own from the next period on, and
+ * rejoins the combined transfer after it succeeds.
+ */
+static void i2c_poller_run(struct i2c_poll_worker_t *worker, struct i2c_poll_dev_t **due, int n) {
+	struct wiringXI2CMsg_t msgs[I2C_POLLER_BATCH*2];
+	struct i2c_poll_dev_t *batch[I2C_POLLER_BATCH];
+	uint64_t timestamp = 0, done = 0;
+	int i = 0, ret = 0, nbatch = 0;
+
+	for(i=0;i<n;i++) {
+		if(due[i]->solo == 1) {
+			i2c_poller_msgs(msgs, due[i]);
+			timestamp = i2c_poller_now();
+			ret = wiringXI2CBusTransfer(worker->bus, msgs, 2);
+			due[i]->solo = (ret < 0) ? 1 : 0;
+			i2c_poller_complete(due[i], timestamp, i2c_poller_now(), (ret < 0) ? 0 : 1);
+		} else {
+			batch[nbatch++] = due[i];
+		}
+	}
+	if(nbatch == 0) {
+		return;
+	}
+
+	/* All other devices that are due share a single combined transfer */
+	for(i=0;i<nbatch;i++) {
+		i2c_poller_msgs(&msgs[i*2], batch[i]);
+	}
+	timestamp = i2c_poller_now();
+	ret = wiringXI2CBusTransfer(worker->bus, msgs, nbatch*2);
+	done = i2c_poller_now();
+
+	for(i=0;i<nbatch;i++) {
+		if(ret < 0 && nbatch > 1) {
+			batch[i]->solo = 1;
+		}
+		i2c_poller_complete(batch[i], timestamp, done, (ret < 0) ? 0 : 1);
+	}
+}
+
+static void *i2c_poller_thread(void *param) {
+	struct i2c_poll_worker_t *worker = param;
+	struct wiringXI2CPoller_t *poller = worker->poller;
+	struct i2c_poll_dev_t *due[I2C_POLLER_BATCH];
+	uint64_t start = 0, next = 0, now = 0;
+	int i = 0, n = 0;
+
+	/* Start all devices on the same grid so their reads line up */
+	start = i2c_poller_now();
+	for(i=0;i<worker->ndevs;i++) {
+		worker->devs[i]->deadline = start;
+	}
+
+	while(1) {
+		next = worker->devs[0]->deadline;
+		for(i=1;i<worker->ndevs;i++) {
+			if(worker->devs[i]->deadline < next) {
+				next = worker->devs[i]->deadline;
+			}
+		}
+		if(i2c_poller_wait(poller, next) != 0) {
+			break;
+		}
+
+		/*
+		 * Devices due within one tick of now are
+		 * read together instead of waking up again.
+		 */
+		now = i2c_poller_now();
+		n = 0;
+		for(i=0;i<worker->ndevs;i++) {
+			if(worker->devs[i]->deadline <= now + poller->tick) {
+				due[n++] = worker->devs[i];
+				if(n == I2C_POLLER_BATCH) {
+					i2c_poller_run(worker, due, n);
+					n = 0;
+				}
+			}
+		}
+		if(n > 0) {
+			i2c_poller_run(worker, due, n);
+		}
+	}
+
+	return NULL;
+}
+
+EXPORT struct wiringXI2CPoller_t *wiringXI2CPollerSetup(unsigned int tick_us, int priority) {
+	struct wiringXI2CPoller_t *poller = NULL;
+	pthread_condattr_t attr;
+
+	if((poller = malloc(sizeof(struct wiringXI2CPoller_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(poller, 0, sizeof(struct wiringXI2CPoller_t));
+
+	poller->tick = (uint64_t)((tick_us == 0) ? 500 : tick_us) * 1000ULL;
+	poller->priority = priority;
+
+	pthread_mutex_init(&poller->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&poller->signal, &attr);
+	pthread_condattr_destroy(&attr);
+
+	return poller;
+}
+
+EXPORT int wiringXI2CPollerAdd(struct wiringXI2CPoller_t *poller, struct wiringXI2CPollConfig_t *config) {
+	struct wiringXI2CBusStats_t busstats;
+	struct i2c_poll_dev_t *dev = NULL;
+
+	if(poller == NULL) {
+		return -1;
+	}
+	if(poller->nworkers > 0) {
+		wiringXLog(LOG_ERR, "wiringX I2C poller devices must be added before starting");
+		return -1;
+	}
+	if(wiringXI2CBusStats(config->bus, &busstats) < 0) {
+		return -1;
+	}
+	if(config->len <= 0 || config->len > I2C_BLOCK_MAX) {
+		wiringXLog(LOG_ERR, "wiringX I2C poller can read 1 to %d bytes per device", I2C_BLOCK_MAX);
+		return -1;
+	}
+	if(config->period_us == 0) {
+		wiringXLog(LOG_ERR, "wiringX I2C poller needs a period above zero");
+		return -1;
+	}
+
+	if((dev = malloc(sizeof(struct i2c_poll_dev_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(dev, 0, sizeof(struct i2c_poll_dev_t));
+	memcpy(&dev->config, config, sizeof(struct wiringXI2CPollConfig_t));
+
+	if(dev->config.ring_size == 0) {
+		dev->config.ring_size = 64;
+	}
+	dev->reg = (unsigned char)config->reg;
+	dev->period = (uint64_t)config->period_us * 1000ULL;
+	ring_init(&dev->ring, sizeof(struct wiringXI2CPollSample_t), dev->config.ring_size);
+
+	if((poller->devs = realloc(poller->devs, sizeof(struct i2c_poll_dev_t *)*(poller->ndevs+1))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	poller->devs[poller->ndevs] = dev;
+
+	return poller->ndevs++;
+}
+
+static int i2c_poller_spawn(struct wiringXI2CPoller_t *poller, struct i2c_poll_worker_t *worker) {
+	struct sched_param param;
+	pthread_attr_t attr;
+	int ret = 0;
+
+	pthread_attr_init(&attr);
+	if(poller->priority > 0) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = poller->priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	if((ret = pthread_create(&worker->thread, &attr, i2c_poller_thread, worker)) != 0 && poller->priority > 0) {
+		wiringXLog(LOG_WARNING, "wiringX I2C poller could not get realtime priority %d, running at default priority", poller->priority);
+		pthread_attr_destroy(&attr);
+		pthread_attr_init(&attr);
+		ret = pthread_create(&worker->thread, &attr, i2c_poller_thread, worker);
+	}
+	pthread_attr_destroy(&attr);
+
+	if(ret != 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to start an I2C poller thread (%s)", strerror(ret));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Starts one worker per bus, so devices on
+ * different buses are read in parallel while
+ * devices on the same bus never contend.
+ */
+EXPORT int wiringXI2CPollerStart(struct wiringXI2CPoller_t *poller) {
+	struct i2c_poll_worker_t *worker = NULL;
+	int i = 0, x = 0;
+
+	if(poller == NULL || poller->ndevs == 0 || poller->nworkers > 0) {
+		return -1;
+	}
+
+	if((poller->workers = malloc(sizeof(struct i2c_poll_worker_t)*poller->ndevs)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(poller->workers, 0, sizeof(struct i2c_poll_worker_t)*poller->ndevs);
+
+	for(i=0;i<poller->ndevs;i++) {
+		worker = NULL;
+		for(x=0;x<poller->nworkers;x++) {
+			if(poller->workers[x].bus == poller->devs[i]->config.bus) {
+				worker = &poller->workers[x];
+				break;
+			}
+		}
+		if(worker == NULL) {
+			worker = &poller->workers[poller->nworkers++];
+			worker->poller = poller;
+			worker->bus = poller->devs[i]->config.bus;
+			if((worker->devs = malloc(sizeof(struct i2c_poll_dev_t *)*poller->ndevs)) == NULL) {
+				fprintf(stderr, "out of memory\n");
+				exit(-1);
+			}
+		}
+		worker->devs[worker->ndevs++] = poller->devs[i];
+	}
+
+	poller->running = 1;
+	for(i=0;i<poller->nworkers;i++) {
+		if(i2c_poller_spawn(poller, &poller->workers[i]) < 0) {
+			pthread_mutex_lock(&poller->lock);
+			poller->running = 0;
+			pthread_cond_broadcast(&poller->signal);
+			pthread_mutex_unlock(&poller->lock);
+			for(x=0;x<i;x++) {
+				pthread_join(poller->workers[x].thread, NULL);
+			}
+			for(x=0;x<poller->nworkers;x++) {
+				free(poller->workers[x].devs);
+			}
+			free(poller->workers);
+			poller->workers = NULL;
+			poller->nworkers = 0;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXI2CPollerRead(struct wiringXI2CPoller_t *poller, int device, struct wiringXI2CPollSample_t *samples, int max) {
+	if(poller == NULL || device < 0 || device >= poller->ndevs || max <= 0) {
+		return -1;
+	}
+	return (int)ring_pop(&poller->devs[device]->ring, samples, (size_t)max);
+}
+
+EXPORT int wiringXI2CPollerStats(struct wiringXI2CPoller_t *poller, int device, struct wiringXI2CPollStats_t *stats) {
+	struct i2c_poll_dev_t *dev = NULL;
+	uint64_t total = 0;
+
+	if(poller == NULL || device < 0 || device >= poller->ndevs) {
+		return -1;
+	}
+	dev = poller->devs[device];
+
+	stats->reads = __atomic_load_n(&dev->stats.reads, __ATOMIC_RELAXED);
+	stats->overruns = __atomic_load_n(&dev->stats.overruns, __ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&dev->stats.dropped, __ATOMIC_RELAXED);
+	stats->errors = __atomic_load_n(&dev->stats.errors, __ATOMIC_RELAXED);
+	stats->max_latency_ns = __atomic_load_n(&dev->stats.max_latency_ns, __ATOMIC_RELAXED);
+
+	total = stats->reads + stats->errors;
+	if(total > 0) {
+		stats->avg_latency_ns = __atomic_load_n(&dev->latency, __ATOMIC_RELAXED) / total;
+	} else {
+		stats->avg_latency_ns = 0;
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXI2CPollerStop(struct wiringXI2CPoller_t *poller) {
+	int i = 0;
+
+	if(poller == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&poller->lock);
+	poller->running = 0;
+	pthread_cond_broadcast(&poller->signal);
+	pthread_mutex_unlock(&poller->lock);
+
+	for(i=0;i<poller->nworkers;i++) {
+		pthread_join(poller->workers[i].thread, NULL);
+		free(poller->workers[i].devs);
+	}
+	if(poller->workers != NULL) {
+		free(poller->workers);
+	}
+
+	for(i=0;i<poller->ndevs;i++) {
+		ring_gc(&poller->devs[i]->ring);
+		free(poller->devs[i]);
+	}
+	if(poller->devs != NULL) {
+		free(poller->devs);
+	}
+
+	pthread_mutex_destroy(&poller->lock);
+	pthread_cond_destroy(&poller->signal);
+	free(poller);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_I2C_POLLER_H_
+#define _WIRINGX_I2C_POLLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wiringx.h"
+
+typedef struct wiringXI2CPollConfig_t {
+	/* Handle returned by wiringXI2CBusOpen */
+	int bus;
+	int addr;
+	/* First register of the read and number of bytes, up to I2C_BLOCK_MAX */
+	int reg;
+	int len;
+	unsigned int period_us;
+	/* Number of samples the ring can hold */
+	size_t ring_size;
+} wiringXI2CPollConfig_t;
+
+typedef struct wiringXI2CPollSample_t {
+	/* CLOCK_MONOTONIC in nanoseconds at the start of the transfer */
+	uint64_t timestamp;
+	uint32_t seq;
+	uint8_t len;
+	uint8_t data[I2C_BLOCK_MAX];
+} wiringXI2CPollSample_t;
+
+typedef struct wiringXI2CPollStats_t {
+	uint64_t reads;
+	/* Periods skipped because the bus could not keep up */
+	uint64_t overruns;
+	/* Samples lost because the consumer did not drain the ring */
+	uint64_t dropped;
+	uint64_t errors;
+	/* Time from the deadline until the read completed */
+	uint64_t avg_latency_ns;
+	uint64_t max_latency_ns;
+} wiringXI2CPollStats_t;
+
+struct wiringXI2CPoller_t;
+
+struct wiringXI2CPoller_t *wiringXI2CPollerSetup(unsigned int tick_us, int priority);
+int wiringXI2CPollerAdd(struct wiringXI2CPoller_t *, struct wiringXI2CPollConfig_t *);
+int wiringXI2CPollerStart(struct wiringXI2CPoller_t *);
+int wiringXI2CPollerRead(struct wiringXI2CPoller_t *, int device, struct wiringXI2CPollSample_t *, int);
+int wiringXI2CPollerStats(struct wiringXI2CPoller_t *, int device, struct wiringXI2CPollStats_t *);
+int wiringXI2CPollerStop(struct wiringXI2CPoller_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,329 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+#endif
+
+#include "wiringx.h"
+#include "ledstrip.h"
+
+/* At least 80us of low level latches the data */
+#define LEDSTRIP_RESET_BYTES	40
+
+typedef struct wiringXLEDStrip_t {
+	int channel;
+	int nleds;
+	int bpp;
+
+	unsigned char *staging;
+	unsigned char *buffer[2];
+	size_t len;
+	int back;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t signal;
+	int running;
+	int busy;
+	int queued;
+	int error;
+} wiringXLEDStrip_t;
+
+/*
+ * Two data bits share one output byte:
+ * 0x88 with 0x60 added for a high first bit
+ * and 0x06 added for a high second bit.
+ */
+static void ledstrip_encode_scalar(unsigned char *out, const unsigned char *in, size_t len) {
+	static const unsigned char pair[4] = { 0x88, 0x8E, 0xE8, 0xEE };
+	size_t i = 0;
+
+	for(i=0;i<len;i++) {
+		out[0] = pair[(in[i] >> 6) & 0x03];
+		out[1] = pair[(in[i] >> 4) & 0x03];
+		out[2] = pair[(in[i] >> 2) & 0x03];
+		out[3] = pair[in[i] & 0x03];
+		out += 4;
+	}
+}
+
+#if defined(__SSE2__)
+static size_t ledstrip_encode_simd(unsigned char *out, const unsigned char *in, size_t len) {
+	const __m128i base = _mm_set1_epi8((char)0x88);
+	const __m128i hi = _mm_set1_epi8(0x60);
+	const __m128i lo = _mm_set1_epi8(0x06);
+	__m128i x, e[4], m, a, b, c, d;
+	size_t i = 0;
+	int j = 0;
+
+	for(i=0;i+16<=len;i+=16) {
+		x = _mm_loadu_si128((const __m128i *)&in[i]);
+		for(j=0;j<4;j++) {
+			m = _mm_set1_epi8((char)(0x80 >> (j*2)));
+			a = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(x, m), m), hi);
+			m = _mm_set1_epi8((char)(0x40 >> (j*2)));
+			b = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(x, m), m), lo);
+			e[j] = _mm_or_si128(base, _mm_or_si128(a, b));
+		}
+		/* Interleave so each input byte yields e0 e1 e2 e3 */
+		a = _mm_unpacklo_epi8(e[0], e[1]);
+		b = _mm_unpackhi_epi8(e[0], e[1]);
+		c = _mm_unpacklo_epi8(e[2], e[3]);
+		d = _mm_unpackhi_epi8(e[2], e[3]);
+		_mm_storeu_si128((__m128i *)&out[i*4], _mm_unpacklo_epi16(a, c));
+		_mm_storeu_si128((__m128i *)&out[i*4+16], _mm_unpackhi_epi16(a, c));
+		_mm_storeu_si128((__m128i *)&out[i*4+32], _mm_unpacklo_epi16(b, d));
+		_mm_storeu_si128((__m128i *)&out[i*4+48], _mm_unpackhi_epi16(b, d));
+	}
+	return i;
+}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static size_t ledstrip_encode_simd(unsigned char *out, const unsigned char *in, size_t len) {
+	const uint8x16_t base = vdupq_n_u8(0x88);
+	const uint8x16_t hi = vdupq_n_u8(0x60);
+	const uint8x16_t lo = vdupq_n_u8(0x06);
+	uint8x16x4_t e;
+	uint8x16_t x;
+	size_t i = 0;
+
+	for(i=0;i+16<=len;i+=16) {
+		x = vld1q_u8(&in[i]);
+		e.val[0] = vorrq_u8(base, vorrq_u8(vandq_u8(vtstq_u8(x, vdupq_n_u8(0x80)), hi), vandq_u8(vtstq_u8(x, vdupq_n_u8(0x40)), lo)));
+		e.val[1] = vorrq_u8(base, vorrq_u8(vandq_u8(vtstq_u8(x, vdupq_n_u8(0x20)), hi), vandq_u8(vtstq_u8(x, vdupq_n_u8(0x10)), lo)));
+		e.val[2] = vorrq_u8(base, vorrq_u8(vandq_u8(vtstq_u8(x, vdupq_n_u8(0x08)), hi), vandq_u8(vtstq_u8(x, vdupq_n_u8(0x04)), lo)));
+		e.val[3] = vorrq_u8(base, vorrq_u8(vandq_u8(vtstq_u8(x, vdupq_n_u8(0x02)), hi), vandq_u8(vtstq_u8(x, vdupq_n_u8(0x01)), lo)));
+		/* vst4 does the byte interleaving for free */
+		vst4q_u8(&out[i*4], e);
+	}
+	return i;
+}
+#else
+static size_t ledstrip_encode_simd(unsigned char *out, const unsigned char *in, size_t len) {
+	return 0;
+}
+#endif
+
+/*
+ * Encodes len bytes of wire ordered color data
+ * into len*4 bytes of SPI symbols.
+ */
+EXPORT size_t wiringXLEDStripEncode(unsigned char *out, const unsigned char *in, size_t len) {
+	size_t done = ledstrip_encode_simd(out, in, len);
+	ledstrip_encode_scalar(&out[done*4], &in[done], len-done);
+	return len*4;
+}
+
+static size_t ledstrip_spidev_bufsiz(void) {
+	unsigned long size = 0;
+	FILE *fp = NULL;
+
+	if((fp = fopen("/sys/module/spidev/parameters/bufsiz", "r")) != NULL) {
+		if(fscanf(fp, "%lu", &size) != 1) {
+			size = 0;
+		}
+		fclose(fp);
+	}
+	/* This is the spidev default */
+	if(size == 0) {
+		size = 4096;
+	}
+	return (size_t)size;
+}
+
+/*
+ * The encoded frame is handed to spidev in place and
+ * in one message. Any gap between two messages can
+ * outlast the reset time and latch half a frame.
+ */
+static int ledstrip_send(struct wiringXLEDStrip_t *strip, const unsigned char *data) {
+	struct wiringXSPITransfer_t xfer;
+
+	memset(&xfer, 0, sizeof(xfer));
+	xfer.tx = data;
+	xfer.len = (unsigned int)strip->len;
+	xfer.speed = LEDSTRIP_SPI_SPEED;
+	xfer.bits_per_word = 8;
+
+	return wiringXSPITransfer(strip->channel, &xfer, 1);
+}
+
+static void *ledstrip_thread(void *param) {
+	struct wiringXLEDStrip_t *strip = param;
+	int idx = 0, ret = 0;
+
+	pthread_mutex_lock(&strip->lock);
+	while(1) {
+		while(strip->running == 1 && strip->queued == -1) {
+			pthread_cond_wait(&strip->signal, &strip->lock);
+		}
+		if(strip->queued == -1) {
+			break;
+		}
+		idx = strip->queued;
+		strip->queued = -1;
+		pthread_mutex_unlock(&strip->lock);
+
+		ret = ledstrip_send(strip, strip->buffer[idx]);
+
+		pthread_mutex_lock(&strip->lock);
+		strip->error = ret;
+		strip->busy = 0;
+		pthread_cond_broadcast(&strip->signal);
+	}
+	pthread_mutex_unlock(&strip->lock);
+
+	return NULL;
+}
+
+EXPORT struct wiringXLEDStrip_t *wiringXLEDStripSetup(int channel, int nleds, enum ledstrip_type_t type) {
+	struct wiringXLEDStrip_t *strip = NULL;
+	size_t len = 0, bufsiz = 0;
+	int i = 0, ret = 0;
+
+	if(nleds <= 0) {
+		wiringXLog(LOG_ERR, "wiringX LED strip needs at least one led");
+		return NULL;
+	}
+	if(type != LEDSTRIP_WS2812 && type != LEDSTRIP_SK6812_RGBW) {
+		wiringXLog(LOG_ERR, "wiringX LED strip does not support type %d", type);
+		return NULL;
+	}
+
+	len = (size_t)nleds*(size_t)((type == LEDSTRIP_SK6812_RGBW) ? 4 : 3)*4 + LEDSTRIP_RESET_BYTES;
+	if(len > (bufsiz = ledstrip_spidev_bufsiz())) {
+		wiringXLog(LOG_ERR, "wiringX LED strip frame of %zu bytes does not fit the %zu byte spidev buffer, raise it with spidev.bufsiz=%zu", len, bufsiz, len);
+		return NULL;
+	}
+
+	if((strip = malloc(sizeof(struct wiringXLEDStrip_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(strip, 0, sizeof(struct wiringXLEDStrip_t));
+
+	strip->channel = channel;
+	strip->nleds = nleds;
+	strip->bpp = (type == LEDSTRIP_SK6812_RGBW) ? 4 : 3;
+	strip->len = len;
+	strip->queued = -1;
+	strip->running = 1;
+
+	if((strip->staging = malloc((size_t)nleds*(size_t)strip->bpp)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	for(i=0;i<2;i++) {
+		if((strip->buffer[i] = malloc(strip->len)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		/* The latch tail is never overwritten */
+		memset(strip->buffer[i], 0, strip->len);
+	}
+
+	pthread_mutex_init(&strip->lock, NULL);
+	pthread_cond_init(&strip->signal, NULL);
+
+	if((ret = pthread_create(&strip->thread, NULL, ledstrip_thread, strip)) != 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to start the LED strip thread (%s)", strerror(ret));
+		pthread_mutex_destroy(&strip->lock);
+		pthread_cond_destroy(&strip->signal);
+		free(strip->buffer[0]);
+		free(strip->buffer[1]);
+		free(strip->staging);
+		free(strip);
+		return NULL;
+	}
+
+	return strip;
+}
+
+/*
+ * Encodes the next frame while the previous one is
+ * still being clocked out and queues it as soon as
+ * the transmitter is free.
+ */
+EXPORT int wiringXLEDStripShow(struct wiringXLEDStrip_t *strip, const unsigned char *pixels) {
+	unsigned char *out = NULL, *p = strip->staging;
+	int i = 0, ret = 0;
+
+	for(i=0;i<strip->nleds;i++) {
+		p[0] = pixels[1];
+		p[1] = pixels[0];
+		p[2] = pixels[2];
+		if(strip->bpp == 4) {
+			p[3] = pixels[3];
+		}
+		p += strip->bpp;
+		pixels += strip->bpp;
+	}
+
+	out = strip->buffer[strip->back];
+	wiringXLEDStripEncode(out, strip->staging, (size_t)strip->nleds*(size_t)strip->bpp);
+
+	pthread_mutex_lock(&strip->lock);
+	while(strip->busy == 1) {
+		pthread_cond_wait(&strip->signal, &strip->lock);
+	}
+	ret = strip->error;
+	strip->busy = 1;
+	strip->queued = strip->back;
+	strip->back ^= 1;
+	pthread_cond_broadcast(&strip->signal);
+	pthread_mutex_unlock(&strip->lock);
+
+	return ret;
+}
+
+EXPORT int wiringXLEDStripWait(struct wiringXLEDStrip_t *strip) {
+	int ret = 0;
+
+	pthread_mutex_lock(&strip->lock);
+	while(strip->busy == 1) {
+		pthread_cond_wait(&strip->signal, &strip->lock);
+	}
+	ret = strip->error;
+	pthread_mutex_unlock(&strip->lock);
+
+	return ret;
+}
+
+EXPORT void wiringXLEDStripGC(struct wiringXLEDStrip_t *strip) {
+	if(strip == NULL) {
+		return;
+	}
+
+	wiringXLEDStripWait(strip);
+
+	pthread_mutex_lock(&strip->lock);
+	strip->running = 0;
+	pthread_cond_broadcast(&strip->signal);
+	pthread_mutex_unlock(&strip->lock);
+	pthread_join(strip->thread, NULL);
+
+	pthread_mutex_destroy(&strip->lock);
+	pthread_cond_destroy(&strip->signal);
+	free(strip->buffer[0]);
+	free(strip->buffer[1]);
+	free(strip->staging);
+	free(strip);
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_LEDSTRIP_H_
+#define _WIRINGX_LEDSTRIP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "wiringx.h"
+
+/*
+ * Every data bit is sent as a 4 bit SPI symbol,
+ * 1000 for a zero and 1110 for a one, which gives
+ * 312.5ns per symbol bit at this clock.
+ */
+#define LEDSTRIP_SPI_SPEED	3200000
+
+enum ledstrip_type_t {
+	/* RGB input, sent as GRB */
+	LEDSTRIP_WS2812 = 0,
+	/* RGBW input, sent as GRBW */
+	LEDSTRIP_SK6812_RGBW = 2
+};
+
+struct wiringXLEDStrip_t;
+
+struct wiringXLEDStrip_t *wiringXLEDStripSetup(int channel, int nleds, enum ledstrip_type_t type);
+int wiringXLEDStripShow(struct wiringXLEDStrip_t *, const unsigned char *pixels);
+int wiringXLEDStripWait(struct wiringXLEDStrip_t *);
+void wiringXLEDStripGC(struct wiringXLEDStrip_t *);
+
+size_t wiringXLEDStripEncode(unsigned char *out, const unsigned char *in, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,507 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <termios.h>
+
+#include "wiringx.h"
+#include "modbus.h"
+
+/* Addressable slaves, 0 is broadcast and has no reply */
+#define MODBUS_SLAVE_MIN	1
+#define MODBUS_SLAVE_MAX	247
+/*
+ * Unused registers a merged poll may read to bridge two
+ * items. Each costs 2 bytes, a separate request costs a
+ * request frame, a reply header and two silent gaps.
+ */
+#define MODBUS_MERGE_GAP	8
+#define MODBUS_EXCEPTION	0x80
+#define MODBUS_ILLEGAL_ADDRESS	0x02
+
+typedef struct modbus_poll_t {
+	int slave;
+	enum modbus_function_t function;
+	int addr;
+	int count;
+	uint64_t period;
+	uint64_t due;
+	uint16_t *values;
+	int status;
+} modbus_poll_t;
+
+struct wiringXModbus_t {
+	int fd;
+	int timeout;
+
+	/* Silent interval between frames, t3.5 */
+	uint64_t gap_ns;
+	/* When the bus last fell silent */
+	uint64_t idle;
+	int exception;
+
+	struct modbus_poll_t *polls;
+	struct modbus_poll_t **due;
+	int nrpolls;
+
+	struct wiringXModbusStats_t stats;
+};
+
+static const uint16_t modbus_crc_table[256] = {
+	0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+	0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+	0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+	0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+	0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+	0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+	0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+	0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+	0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+	0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+	0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+	0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+	0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+	0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+	0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+	0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+	0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+	0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+	0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+	0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+	0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+	0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+	0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+	0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+	0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+	0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+	0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+	0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+	0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+	0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+	0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+	0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+static uint64_t modbus_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void modbus_sleep_until(uint64_t deadline) {
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+	ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+EXPORT uint16_t wiringXModbusCRC(const unsigned char *data, size_t len) {
+	uint16_t crc = 0xFFFF;
+	size_t i = 0;
+
+	for(i=0;i<len;i++) {
+		crc = (uint16_t)((crc >> 8) ^ modbus_crc_table[(crc ^ data[i]) & 0xFF]);
+	}
+
+	return crc;
+}
+
+/*
+ * The specification fixes the gap to 1.75 ms above
+ * 19200 baud, below it is 3.5 characters of 11 bits.
+ */
+static uint64_t modbus_gap_ns(int fd) {
+	int baud = wiringXSerialGetBaud(fd);
+
+	if(baud <= 0 || baud > 19200) {
+		return 1750000ULL;
+	}
+	return 35ULL * 11ULL * 1000000000ULL / (10ULL * (uint64_t)baud);
+}
+
+EXPORT struct wiringXModbus_t *wiringXModbusSetup(int fd, int timeout) {
+	struct wiringXModbus_t *mb = NULL;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return NULL;
+	}
+
+	if((mb = malloc(sizeof(struct wiringXModbus_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(mb, 0, sizeof(struct wiringXModbus_t));
+
+	mb->fd = fd;
+	mb->timeout = (timeout > 0) ? timeout : 1000;
+	mb->gap_ns = modbus_gap_ns(fd);
+	mb->idle = modbus_now();
+
+	return mb;
+}
+
+/*
+ * Sends a request and reads back a reply of exactly
+ * expect bytes, or the 5 byte exception reply. The
+ * request buffer must have room for the CRC.
+ */
+static int modbus_transact(struct wiringXModbus_t *mb, unsigned char *req, size_t len, unsigned char *resp, size_t expect) {
+	uint16_t crc = wiringXModbusCRC(req, len);
+	int n = 0;
+
+	req[len++] = (unsigned char)(crc & 0xFF);
+	req[len++] = (unsigned char)(crc >> 8);
+
+	mb->exception = 0;
+
+	/* Only wait for what is left of the silent interval */
+	modbus_sleep_until(mb->idle + mb->gap_ns);
+	/* Whatever arrived in between belongs to no request of ours */
+	tcflush(mb->fd, TCIFLUSH);
+
+#ifndef __FreeBSD__
+	n = wiringXSerialRS485Write(mb->fd, req, len);
+#else
+	n = wiringXSerialWrite(mb->fd, req, len);
+#endif
+	mb->stats.requests++;
+	if(n != (int)len) {
+		mb->idle = modbus_now();
+		wiringXLog(LOG_ERR, "wiringX failed to send modbus request to slave %d", req[0]);
+		return -1;
+	}
+	mb->stats.tx_bytes += len;
+
+	/* Every reply, exceptions included, is at least 5 bytes */
+	n = wiringXSerialRead(mb->fd, resp, 5, mb->timeout);
+	if(n == 5 && (resp[1] & MODBUS_EXCEPTION) == 0 && expect > 5) {
+		if((n = wiringXSerialRead(mb->fd, &resp[5], expect-5, mb->timeout)) >= 0) {
+			n += 5;
+		}
+	} else if(n == 5) {
+		expect = 5;
+	}
+	mb->idle = modbus_now();
+
+	if(n > 0) {
+		mb->stats.rx_bytes += (uint64_t)n;
+	}
+	if(n != (int)expect) {
+		mb->stats.timeouts++;
+		return -1;
+	}
+
+	if(wiringXModbusCRC(resp, expect) != 0 || resp[0] != req[0] || (resp[1] & ~MODBUS_EXCEPTION) != req[1]) {
+		mb->stats.crc_errors++;
+		return -1;
+	}
+	if((resp[1] & MODBUS_EXCEPTION) != 0) {
+		mb->stats.exceptions++;
+		mb->exception = resp[2];
+		return -1;
+	}
+
+	return 0;
+}
+
+static int modbus_valid(int slave, int addr, int count, int max) {
+	if(slave < MODBUS_SLAVE_MIN || slave > MODBUS_SLAVE_MAX) {
+		wiringXLog(LOG_ERR, "wiringX modbus slave %d is out of range", slave);
+		return -1;
+	}
+	if(count < 1 || count > max || addr < 0 || addr + count > 0x10000) {
+		wiringXLog(LOG_ERR, "wiringX modbus register range %d+%d is not valid", addr, count);
+		return -1;
+	}
+	return 0;
+}
+
+static int modbus_read(struct wiringXModbus_t *mb, int slave, enum modbus_function_t function, int addr, int count, uint16_t *values) {
+	unsigned char req[8], resp[5+2*MODBUS_MAX_READ];
+	int i = 0;
+
+	req[0] = (unsigned char)slave;
+	req[1] = (unsigned char)function;
+	req[2] = (unsigned char)(addr >> 8);
+	req[3] = (unsigned char)(addr & 0xFF);
+	req[4] = (unsigned char)(count >> 8);
+	req[5] = (unsigned char)(count & 0xFF);
+
+	if(modbus_transact(mb, req, 6, resp, 5 + 2*(size_t)count) != 0) {
+		return -1;
+	}
+	if(resp[2] != 2*count) {
+		mb->stats.crc_errors++;
+		return -1;
+	}
+
+	for(i=0;i<count;i++) {
+		values[i] = (uint16_t)((resp[3+2*i] << 8) | resp[4+2*i]);
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXModbusReadRegisters(struct wiringXModbus_t *mb, int slave, enum modbus_function_t function, int addr, int count, uint16_t *values) {
+	if(mb == NULL || values == NULL) {
+		return -1;
+	}
+	if(function != MODBUS_READ_HOLDING && function != MODBUS_READ_INPUT) {
+		wiringXLog(LOG_ERR, "wiringX modbus function %d does not read registers", function);
+		return -1;
+	}
+	if(modbus_valid(slave, addr, count, MODBUS_MAX_READ) != 0) {
+		return -1;
+	}
+
+	return modbus_read(mb, slave, function, addr, count, values);
+}
+
+EXPORT int wiringXModbusWriteRegister(struct wiringXModbus_t *mb, int slave, int addr, uint16_t value) {
+	unsigned char req[8], resp[8];
+
+	if(mb == NULL || modbus_valid(slave, addr, 1, 1) != 0) {
+		return -1;
+	}
+
+	req[0] = (unsigned char)slave;
+	req[1] = MODBUS_WRITE_SINGLE;
+	req[2] = (unsigned char)(addr >> 8);
+	req[3] = (unsigned char)(addr & 0xFF);
+	req[4] = (unsigned char)(value >> 8);
+	req[5] = (unsigned char)(value & 0xFF);
+
+	if(modbus_transact(mb, req, 6, resp, 8) != 0) {
+		return -1;
+	}
+	/* The reply echoes the request */
+	if(memcmp(req, resp, 6) != 0) {
+		mb->stats.crc_errors++;
+		return -1;
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXModbusWriteRegisters(struct wiringXModbus_t *mb, int slave, int addr, int count, const uint16_t *values) {
+	unsigned char req[9+2*MODBUS_MAX_WRITE], resp[8];
+	int i = 0;
+
+	if(mb == NULL || values == NULL || modbus_valid(slave, addr, count, MODBUS_MAX_WRITE) != 0) {
+		return -1;
+	}
+
+	req[0] = (unsigned char)slave;
+	req[1] = MODBUS_WRITE_MULTIPLE;
+	req[2] = (unsigned char)(addr >> 8);
+	req[3] = (unsigned char)(addr & 0xFF);
+	req[4] = (unsigned char)(count >> 8);
+	req[5] = (unsigned char)(count & 0xFF);
+	req[6] = (unsigned char)(2*count);
+	for(i=0;i<count;i++) {
+		req[7+2*i] = (unsigned char)(values[i] >> 8);
+		req[8+2*i] = (unsigned char)(values[i] & 0xFF);
+	}
+
+	if(modbus_transact(mb, req, 7 + 2*(size_t)count, resp, 8) != 0) {
+		return -1;
+	}
+	if(memcmp(req, resp, 6) != 0) {
+		mb->stats.crc_errors++;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The exception code of the last failed request, 0 if none */
+EXPORT int wiringXModbusException(struct wiringXModbus_t *mb) {
+	if(mb == NULL) {
+		return -1;
+	}
+	return mb->exception;
+}
+
+/*
+ * Adds a range of registers that PollRun reads every
+ * period milliseconds into values, which must stay
+ * valid until the modbus master is freed.
+ */
+EXPORT int wiringXModbusPollAdd(struct wiringXModbus_t *mb, int slave, enum modbus_function_t function, int addr, int count, unsigned int period, uint16_t *values) {
+	struct modbus_poll_t *poll = NULL;
+
+	if(mb == NULL || values == NULL) {
+		return -1;
+	}
+	if(function != MODBUS_READ_HOLDING && function != MODBUS_READ_INPUT) {
+		wiringXLog(LOG_ERR, "wiringX modbus function %d can not be polled", function);
+		return -1;
+	}
+	if(modbus_valid(slave, addr, count, MODBUS_MAX_READ) != 0) {
+		return -1;
+	}
+
+	if((mb->polls = realloc(mb->polls, sizeof(struct modbus_poll_t)*(size_t)(mb->nrpolls+1))) == NULL ||
+	   (mb->due = realloc(mb->due, sizeof(struct modbus_poll_t *)*(size_t)(mb->nrpolls+1))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	poll = &mb->polls[mb->nrpolls];
+	memset(poll, 0, sizeof(struct modbus_poll_t));
+
+	poll->slave = slave;
+	poll->function = function;
+	poll->addr = addr;
+	poll->count = count;
+	poll->period = (uint64_t)period * 1000000ULL;
+	poll->due = modbus_now();
+	poll->values = values;
+	/* Not polled yet */
+	poll->status = 1;
+
+	return mb->nrpolls++;
+}
+
+/* 0 when the last poll of the item succeeded, 1 before the first */
+EXPORT int wiringXModbusPollStatus(struct wiringXModbus_t *mb, int item) {
+	if(mb == NULL || item < 0 || item >= mb->nrpolls) {
+		return -1;
+	}
+	return mb->polls[item].status;
+}
+
+static int modbus_poll_cmp(const void *a, const void *b) {
+	const struct modbus_poll_t *x = *(struct modbus_poll_t * const *)a;
+	const struct modbus_poll_t *y = *(struct modbus_poll_t * const *)b;
+
+	if(x->slave != y->slave) {
+		return x->slave - y->slave;
+	}
+	if(x->function != y->function) {
+		return (int)x->function - (int)y->function;
+	}
+	return x->addr - y->addr;
+}
+
+static void modbus_poll_done(struct modbus_poll_t *poll, uint64_t now, int status) {
+	poll->status = status;
+	/* Stay on the schedule grid, but skip what was missed */
+	poll->due += poll->period;
+	if(poll->due <= now) {
+		poll->due = now + poll->period;
+	}
+}
+
+/*
+ * Reads every item that is due. Items of the same
+ * slave and function are merged into as few requests
+ * as the 125 register limit allows, bridging small
+ * holes between them, so the bus spends its time on
+ * payload instead of frame overhead and gaps. Returns
+ * the milliseconds until the next item is due.
+ */
+EXPORT int wiringXModbusPollRun(struct wiringXModbus_t *mb) {
+	struct modbus_poll_t *poll = NULL;
+	uint16_t values[MODBUS_MAX_READ];
+	uint64_t now = 0, next = 0;
+	int i = 0, j = 0, k = 0, nrdue = 0, start = 0, end = 0, ret = 0;
+
+	if(mb == NULL) {
+		return -1;
+	}
+
+	now = modbus_now();
+	for(i=0;i<mb->nrpolls;i++) {
+		if(mb->polls[i].due <= now) {
+			mb->due[nrdue++] = &mb->polls[i];
+		}
+	}
+	qsort(mb->due, (size_t)nrdue, sizeof(struct modbus_poll_t *), modbus_poll_cmp);
+
+	for(i=0;i<nrdue;i=j) {
+		poll = mb->due[i];
+		start = poll->addr;
+		end = poll->addr + poll->count;
+
+		for(j=i+1;j<nrdue;j++) {
+			if(mb->due[j]->slave != poll->slave || mb->due[j]->function != poll->function ||
+			   mb->due[j]->addr > end + MODBUS_MERGE_GAP) {
+				break;
+			}
+			if(mb->due[j]->addr + mb->due[j]->count > end) {
+				if(mb->due[j]->addr + mb->due[j]->count - start > MODBUS_MAX_READ) {
+					break;
+				}
+				end = mb->due[j]->addr + mb->due[j]->count;
+			}
+		}
+
+		ret = modbus_read(mb, poll->slave, poll->function, start, end - start, values);
+		if(ret != 0 && j-i > 1 && mb->exception == MODBUS_ILLEGAL_ADDRESS) {
+			/* A hole we bridged does not exist on this slave */
+			for(k=i;k<j;k++) {
+				ret = modbus_read(mb, mb->due[k]->slave, mb->due[k]->function, mb->due[k]->addr, mb->due[k]->count, mb->due[k]->values);
+				modbus_poll_done(mb->due[k], now, (ret == 0) ? 0 : -1);
+			}
+			continue;
+		}
+
+		for(k=i;k<j;k++) {
+			if(ret == 0) {
+				memcpy(mb->due[k]->values, &values[mb->due[k]->addr - start], sizeof(uint16_t)*(size_t)mb->due[k]->count);
+			}
+			modbus_poll_done(mb->due[k], now, (ret == 0) ? 0 : -1);
+		}
+		if(j-i > 1) {
+			mb->stats.merged += (uint64_t)(j-i);
+		}
+	}
+
+	if(mb->nrpolls == 0) {
+		return 0;
+	}
+
+	next = mb->polls[0].due;
+	for(i=1;i<mb->nrpolls;i++) {
+		if(mb->polls[i].due < next) {
+			next = mb->polls[i].due;
+		}
+	}
+	now = modbus_now();
+
+	return (next > now) ? (int)((next - now + 999999ULL) / 1000000ULL) : 0;
+}
+
+EXPORT int wiringXModbusStats(struct wiringXModbus_t *mb, struct wiringXModbusStats_t *stats) {
+	if(mb == NULL || stats == NULL) {
+		return -1;
+	}
+	memcpy(stats, &mb->stats, sizeof(struct wiringXModbusStats_t));
+	return 0;
+}
+
+EXPORT void wiringXModbusGC(struct wiringXModbus_t *mb) {
+	if(mb == NULL) {
+		return;
+	}
+	if(mb->polls != NULL) {
+		free(mb->polls);
+	}
+	if(mb->due != NULL) {
+		free(mb->due);
+	}
+	free(mb);
+}
@@ -0,0 +1,60 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_MODBUS_H_
+#define _WIRINGX_MODBUS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "wiringx.h"
+
+/* Largest number of registers a single read may return */
+#define MODBUS_MAX_READ		125
+#define MODBUS_MAX_WRITE	123
+
+enum modbus_function_t {
+	MODBUS_READ_HOLDING = 0x03,
+	MODBUS_READ_INPUT = 0x04,
+	MODBUS_WRITE_SINGLE = 0x06,
+	MODBUS_WRITE_MULTIPLE = 0x10
+};
+
+typedef struct wiringXModbusStats_t {
+	uint64_t requests;
+	uint64_t timeouts;
+	uint64_t crc_errors;
+	uint64_t exceptions;
+	/* Poll items served by a request that was merged with others */
+	uint64_t merged;
+	uint64_t tx_bytes;
+	uint64_t rx_bytes;
+} wiringXModbusStats_t;
+
+struct wiringXModbus_t;
+
+struct wiringXModbus_t *wiringXModbusSetup(int fd, int timeout);
+int wiringXModbusReadRegisters(struct wiringXModbus_t *, int slave, enum modbus_function_t, int addr, int count, uint16_t *values);
+int wiringXModbusWriteRegister(struct wiringXModbus_t *, int slave, int addr, uint16_t value);
+int wiringXModbusWriteRegisters(struct wiringXModbus_t *, int slave, int addr, int count, const uint16_t *values);
+int wiringXModbusException(struct wiringXModbus_t *);
+int wiringXModbusPollAdd(struct wiringXModbus_t *, int slave, enum modbus_function_t, int addr, int count, unsigned int period, uint16_t *values);
+int wiringXModbusPollRun(struct wiringXModbus_t *);
+int wiringXModbusPollStatus(struct wiringXModbus_t *, int item);
+int wiringXModbusStats(struct wiringXModbus_t *, struct wiringXModbusStats_t *);
+uint16_t wiringXModbusCRC(const unsigned char *data, size_t len);
+void wiringXModbusGC(struct wiringXModbus_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
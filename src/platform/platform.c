@@ -44,6 +44,9 @@ void platform_register(struct platform_t **platform, char *name) {
 	(*platform)->selectableFd = NULL;
 	(*platform)->validGPIO = NULL;
 	(*platform)->gc = NULL;
+	(*platform)->spiSetup = NULL;
+	(*platform)->spiDataRW = NULL;
+	(*platform)->spiRelease = NULL;
 
 	(*platform)->next = platforms;
 	platforms = *platform;
@@ -32,6 +32,10 @@ typedef struct platform_t {
 	int (*validGPIO)(int);
 	int (*gc)(void);
 
+	int (*spiSetup)(int, int, unsigned int);
+	int (*spiDataRW)(int, unsigned char *, int);
+	int (*spiRelease)(int);
+
 	struct platform_t *next;
 } platform_t;
 
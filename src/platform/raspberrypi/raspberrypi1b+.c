@@ -77,5 +77,9 @@ void raspberrypi1bpInit(void) {
 	raspberrypi1bp->selectableFd = raspberrypi1bp->soc->selectableFd;
 	raspberrypi1bp->gc = raspberrypi1bp->soc->gc;
 
+	raspberrypi1bp->spiSetup = raspberrypi1bp->soc->spiSetup;
+	raspberrypi1bp->spiDataRW = raspberrypi1bp->soc->spiDataRW;
+	raspberrypi1bp->spiRelease = raspberrypi1bp->soc->spiRelease;
+
 	raspberrypi1bp->validGPIO = &raspberrypi1bpValidGPIO;
 }
@@ -69,6 +69,10 @@ void raspberrypi1b1Init(void) {
 	raspberrypi1b1->selectableFd = raspberrypi1b1->soc->selectableFd;
 	raspberrypi1b1->gc = raspberrypi1b1->soc->gc;
 
+	raspberrypi1b1->spiSetup = raspberrypi1b1->soc->spiSetup;
+	raspberrypi1b1->spiDataRW = raspberrypi1b1->soc->spiDataRW;
+	raspberrypi1b1->spiRelease = raspberrypi1b1->soc->spiRelease;
+
 	raspberrypi1b1->validGPIO = &raspberrypi1b1ValidGPIO;
 
 }
@@ -71,5 +71,9 @@ void raspberrypi1b2Init(void) {
 	raspberrypi1b2->selectableFd = raspberrypi1b2->soc->selectableFd;
 	raspberrypi1b2->gc = raspberrypi1b2->soc->gc;
 
+	raspberrypi1b2->spiSetup = raspberrypi1b2->soc->spiSetup;
+	raspberrypi1b2->spiDataRW = raspberrypi1b2->soc->spiDataRW;
+	raspberrypi1b2->spiRelease = raspberrypi1b2->soc->spiRelease;
+
 	raspberrypi1b2->validGPIO = &raspberrypi1b2ValidGPIO;
 }
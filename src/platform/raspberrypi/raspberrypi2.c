@@ -78,6 +78,10 @@ void raspberrypi2Init(void) {
 	raspberrypi2->selectableFd = raspberrypi2->soc->selectableFd;
 	raspberrypi2->gc = raspberrypi2->soc->gc;
 
+	raspberrypi2->spiSetup = raspberrypi2->soc->spiSetup;
+	raspberrypi2->spiDataRW = raspberrypi2->soc->spiDataRW;
+	raspberrypi2->spiRelease = raspberrypi2->soc->spiRelease;
+
 	raspberrypi2->validGPIO = &raspberrypi2ValidGPIO;
 
 }
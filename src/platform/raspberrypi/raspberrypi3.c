@@ -83,5 +83,9 @@ void raspberrypi3Init(void) {
 	raspberrypi3->selectableFd = raspberrypi3->soc->selectableFd;
 	raspberrypi3->gc = raspberrypi3->soc->gc;
 
+	raspberrypi3->spiSetup = raspberrypi3->soc->spiSetup;
+	raspberrypi3->spiDataRW = raspberrypi3->soc->spiDataRW;
+	raspberrypi3->spiRelease = raspberrypi3->soc->spiRelease;
+
 	raspberrypi3->validGPIO = &raspberrypi3ValidGPIO;
 }
@@ -83,5 +83,9 @@ void raspberrypi4Init(void) {
 	raspberrypi4->selectableFd = raspberrypi4->soc->selectableFd;
 	raspberrypi4->gc = raspberrypi4->soc->gc;
 
+	raspberrypi4->spiSetup = raspberrypi4->soc->spiSetup;
+	raspberrypi4->spiDataRW = raspberrypi4->soc->spiDataRW;
+	raspberrypi4->spiRelease = raspberrypi4->soc->spiRelease;
+
 	raspberrypi4->validGPIO = &raspberrypi4ValidGPIO;
 }
@@ -75,5 +75,9 @@ void raspberrypizeroInit(void) {
 	raspberrypizero->selectableFd = raspberrypizero->soc->selectableFd;
 	raspberrypizero->gc = raspberrypizero->soc->gc;
 
+	raspberrypizero->spiSetup = raspberrypizero->soc->spiSetup;
+	raspberrypizero->spiDataRW = raspberrypizero->soc->spiDataRW;
+	raspberrypizero->spiRelease = raspberrypizero->soc->spiRelease;
+
 	raspberrypizero->validGPIO = &raspberrypizeroValidGPIO;
 }
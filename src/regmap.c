@@ -0,0 +1,410 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "wiringx.h"
+#include "regmap.h"
+
+#define REGMAP_VALID		0x01
+#define REGMAP_DIRTY		0x02
+#define REGMAP_VOLATILE	0x04
+
+/*
+ * Clean registers between two dirty ones are
+ * rewritten with their cached value when that
+ * is cheaper than starting a new transfer.
+ */
+#define REGMAP_GAP	2
+
+typedef struct wiringXRegmap_t {
+	struct wiringXRegmapConfig_t config;
+
+	/* Only used by maps created through wiringXRegmapI2C */
+	int bus;
+	int addr;
+	int refs;
+	struct wiringXRegmap_t *next;
+
+	unsigned char value[REGMAP_SIZE];
+	unsigned char flags[REGMAP_SIZE];
+	int deferred;
+
+	pthread_mutex_t lock;
+	struct wiringXRegmapStats_t stats;
+} wiringXRegmap_t;
+
+static struct wiringXRegmap_t *i2cmaps = NULL;
+static pthread_mutex_t maplock = PTHREAD_MUTEX_INITIALIZER;
+
+static int regmap_i2c_read(void *userdata, int reg, unsigned char *buf, int len) {
+	struct wiringXRegmap_t *map = userdata;
+	return wiringXI2CBusReadRegs(map->bus, map->addr, reg, buf, len);
+}
+
+static int regmap_i2c_write(void *userdata, int reg, const unsigned char *buf, int len) {
+	struct wiringXRegmap_t *map = userdata;
+	return wiringXI2CBusWriteRegs(map->bus, map->addr, reg, buf, len);
+}
+
+static struct wiringXRegmap_t *regmap_alloc(void) {
+	struct wiringXRegmap_t *map = NULL;
+
+	if((map = malloc(sizeof(struct wiringXRegmap_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(map, 0, sizeof(struct wiringXRegmap_t));
+	map->bus = -1;
+	map->addr = -1;
+	map->refs = 1;
+	pthread_mutex_init(&map->lock, NULL);
+
+	return map;
+}
+
+EXPORT struct wiringXRegmap_t *wiringXRegmapSetup(struct wiringXRegmapConfig_t *config) {
+	struct wiringXRegmap_t *map = NULL;
+
+	if(config->read == NULL || config->write == NULL) {
+		wiringXLog(LOG_ERR, "wiringX regmap needs both a read and a write function");
+		return NULL;
+	}
+
+	map = regmap_alloc();
+	memcpy(&map->config, config, sizeof(struct wiringXRegmapConfig_t));
+
+	return map;
+}
+
+/*
+ * Every user of the same device on the same
+ * bus gets the same map, so the cache stays
+ * coherent between drivers.
+ */
+EXPORT struct wiringXRegmap_t *wiringXRegmapI2C(int bus, int addr, int burst) {
+	struct wiringXI2CBusStats_t busstats;
+	struct wiringXRegmap_t *map = NULL;
+
+	if(wiringXI2CBusStats(bus, &busstats) < 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&maplock);
+	for(map=i2cmaps;map!=NULL;map=map->next) {
+		if(map->bus == bus && map->addr == addr) {
+			map->refs++;
+			pthread_mutex_unlock(&maplock);
+			return map;
+		}
+	}
+
+	map = regmap_alloc();
+	map->bus = bus;
+	map->addr = addr;
+	map->config.read = regmap_i2c_read;
+	map->config.write = regmap_i2c_write;
+	map->config.userdata = map;
+	map->config.burst = burst;
+
+	map->next = i2cmaps;
+	i2cmaps = map;
+	pthread_mutex_unlock(&maplock);
+
+	return map;
+}
+
+static int regmap_check(struct wiringXRegmap_t *map, int reg) {
+	if(map == NULL) {
+		return -1;
+	}
+	if(reg < 0 || reg >= REGMAP_SIZE) {
+		wiringXLog(LOG_ERR, "wiringX regmap register %d is out of range", reg);
+		return -1;
+	}
+	return 0;
+}
+
+/* Volatile registers, like status or data registers, are never cached */
+EXPORT int wiringXRegmapVolatile(struct wiringXRegmap_t *map, int first, int last) {
+	int i = 0;
+
+	if(regmap_check(map, first) < 0 || regmap_check(map, last) < 0 || last < first) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	for(i=first;i<=last;i++) {
+		map->flags[i] = REGMAP_VOLATILE;
+	}
+	pthread_mutex_unlock(&map->lock);
+
+	return 0;
+}
+
+static int regmap_read(struct wiringXRegmap_t *map, int reg) {
+	unsigned char value = 0;
+
+	if((map->flags[reg] & (REGMAP_VALID|REGMAP_VOLATILE)) == REGMAP_VALID) {
+		map->stats.hits++;
+		return map->value[reg];
+	}
+
+	map->stats.misses++;
+	map->stats.bus_reads++;
+	if(map->config.read(map->config.userdata, reg, &value, 1) < 0) {
+		return -1;
+	}
+	if((map->flags[reg] & REGMAP_VOLATILE) == 0) {
+		map->value[reg] = value;
+		map->flags[reg] |= REGMAP_VALID;
+	}
+
+	return value;
+}
+
+static int regmap_write(struct wiringXRegmap_t *map, int reg, int value) {
+	unsigned char tmp = (unsigned char)value;
+
+	if((map->flags[reg] & REGMAP_VOLATILE) == 0) {
+		if((map->flags[reg] & REGMAP_VALID) == REGMAP_VALID && map->value[reg] == tmp) {
+			map->stats.skipped++;
+			return 0;
+		}
+		map->value[reg] = tmp;
+		map->flags[reg] |= REGMAP_VALID;
+		if(map->deferred == 1) {
+			map->flags[reg] |= REGMAP_DIRTY;
+			return 0;
+		}
+	}
+
+	map->stats.bus_writes++;
+	if(map->config.write(map->config.userdata, reg, &tmp, 1) < 0) {
+		/* The device state is unknown now */
+		map->flags[reg] &= ~(REGMAP_VALID|REGMAP_DIRTY);
+		return -1;
+	}
+	map->flags[reg] &= ~REGMAP_DIRTY;
+
+	return 0;
+}
+
+static int regmap_cacheable(struct wiringXRegmap_t *map, int reg) {
+	return (map->flags[reg] & (REGMAP_VALID|REGMAP_VOLATILE)) == REGMAP_VALID;
+}
+
+/*
+ * Writes out all dirty registers. With burst
+ * access, adjacent dirty registers and small
+ * clean gaps between them go out in one write.
+ */
+static int regmap_flush(struct wiringXRegmap_t *map) {
+	int reg = 0, last = 0, next = 0, i = 0, ret = 0;
+
+	while(reg < REGMAP_SIZE) {
+		if((map->flags[reg] & REGMAP_DIRTY) == 0) {
+			reg++;
+			continue;
+		}
+
+		last = reg;
+		if(map->config.burst == 1) {
+			next = reg + 1;
+			while(next < REGMAP_SIZE && next - last <= REGMAP_GAP + 1) {
+				if((map->flags[next] & REGMAP_DIRTY) == REGMAP_DIRTY) {
+					last = next;
+				} else if(regmap_cacheable(map, next) == 0) {
+					break;
+				}
+				next++;
+			}
+		}
+
+		map->stats.bus_writes++;
+		if(map->config.write(map->config.userdata, reg, &map->value[reg], last - reg + 1) < 0) {
+			for(i=reg;i<=last;i++) {
+				if((map->flags[i] & REGMAP_DIRTY) == REGMAP_DIRTY) {
+					map->flags[i] &= ~(REGMAP_VALID|REGMAP_DIRTY);
+				}
+			}
+			ret = -1;
+		} else {
+			for(i=reg;i<=last;i++) {
+				map->flags[i] &= ~REGMAP_DIRTY;
+			}
+		}
+		reg = last + 1;
+	}
+
+	return ret;
+}
+
+EXPORT int wiringXRegmapRead(struct wiringXRegmap_t *map, int reg) {
+	int ret = 0;
+
+	if(regmap_check(map, reg) < 0) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	ret = regmap_read(map, reg);
+	pthread_mutex_unlock(&map->lock);
+
+	return ret;
+}
+
+EXPORT int wiringXRegmapWrite(struct wiringXRegmap_t *map, int reg, int value) {
+	int ret = 0;
+
+	if(regmap_check(map, reg) < 0) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	ret = regmap_write(map, reg, value);
+	pthread_mutex_unlock(&map->lock);
+
+	return ret;
+}
+
+/*
+ * Read-modify-write that only touches the bus
+ * when the register was not cached yet or the
+ * value actually changes.
+ */
+EXPORT int wiringXRegmapUpdateBits(struct wiringXRegmap_t *map, int reg, int mask, int value) {
+	int ret = 0;
+
+	if(regmap_check(map, reg) < 0) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	if((ret = regmap_read(map, reg)) >= 0) {
+		ret = regmap_write(map, reg, (ret & ~mask) | (value & mask));
+	}
+	pthread_mutex_unlock(&map->lock);
+
+	return ret;
+}
+
+/* Hold back writes until wiringXRegmapCommit */
+EXPORT int wiringXRegmapBegin(struct wiringXRegmap_t *map) {
+	if(map == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	map->deferred = 1;
+	pthread_mutex_unlock(&map->lock);
+
+	return 0;
+}
+
+EXPORT int wiringXRegmapCommit(struct wiringXRegmap_t *map) {
+	int ret = 0;
+
+	if(map == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	map->deferred = 0;
+	ret = regmap_flush(map);
+	pthread_mutex_unlock(&map->lock);
+
+	return ret;
+}
+
+/* Rewrite every cached register, e.g. after the device was reset */
+EXPORT int wiringXRegmapSync(struct wiringXRegmap_t *map) {
+	int i = 0, ret = 0;
+
+	if(map == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	for(i=0;i<REGMAP_SIZE;i++) {
+		if(regmap_cacheable(map, i) == 1) {
+			map->flags[i] |= REGMAP_DIRTY;
+		}
+	}
+	ret = regmap_flush(map);
+	pthread_mutex_unlock(&map->lock);
+
+	return ret;
+}
+
+/* Forget all cached values, pending writes are dropped as well */
+EXPORT int wiringXRegmapInvalidate(struct wiringXRegmap_t *map) {
+	int i = 0;
+
+	if(map == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	for(i=0;i<REGMAP_SIZE;i++) {
+		map->flags[i] &= REGMAP_VOLATILE;
+	}
+	pthread_mutex_unlock(&map->lock);
+
+	return 0;
+}
+
+EXPORT int wiringXRegmapStats(struct wiringXRegmap_t *map, struct wiringXRegmapStats_t *stats) {
+	if(map == NULL) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&map->lock);
+	memcpy(stats, &map->stats, sizeof(struct wiringXRegmapStats_t));
+	pthread_mutex_unlock(&map->lock);
+
+	return 0;
+}
+
+EXPORT void wiringXRegmapGC(struct wiringXRegmap_t *map) {
+	struct wiringXRegmap_t *tmp = NULL, **prev = NULL;
+
+	if(map == NULL) {
+		return;
+	}
+
+	if(map->bus != -1) {
+		pthread_mutex_lock(&maplock);
+		if(--map->refs > 0) {
+			pthread_mutex_unlock(&maplock);
+			return;
+		}
+		for(prev=&i2cmaps;(tmp=*prev)!=NULL;prev=&tmp->next) {
+			if(tmp == map) {
+				*prev = map->next;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&maplock);
+	}
+
+	/* Do not lose writes that were never committed */
+	pthread_mutex_lock(&map->lock);
+	regmap_flush(map);
+	pthread_mutex_unlock(&map->lock);
+
+	pthread_mutex_destroy(&map->lock);
+	free(map);
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_REGMAP_H_
+#define _WIRINGX_REGMAP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "wiringx.h"
+
+/* Number of 8 bit registers a map covers */
+#define REGMAP_SIZE	256
+
+typedef struct wiringXRegmapConfig_t {
+	/* Access len consecutive registers starting at reg, return -1 on failure */
+	int (*read)(void *userdata, int reg, unsigned char *buf, int len);
+	int (*write)(void *userdata, int reg, const unsigned char *buf, int len);
+	void *userdata;
+	/* The device auto increments the register address, so adjacent registers can be written at once */
+	int burst;
+} wiringXRegmapConfig_t;
+
+typedef struct wiringXRegmapStats_t {
+	uint64_t hits;
+	uint64_t misses;
+	/* Writes skipped because the register already held the value */
+	uint64_t skipped;
+	uint64_t bus_reads;
+	uint64_t bus_writes;
+} wiringXRegmapStats_t;
+
+struct wiringXRegmap_t;
+
+struct wiringXRegmap_t *wiringXRegmapSetup(struct wiringXRegmapConfig_t *);
+struct wiringXRegmap_t *wiringXRegmapI2C(int bus, int addr, int burst);
+int wiringXRegmapVolatile(struct wiringXRegmap_t *, int first, int last);
+int wiringXRegmapRead(struct wiringXRegmap_t *, int reg);
+int wiringXRegmapWrite(struct wiringXRegmap_t *, int reg, int value);
+int wiringXRegmapUpdateBits(struct wiringXRegmap_t *, int reg, int mask, int value);
+int wiringXRegmapBegin(struct wiringXRegmap_t *);
+int wiringXRegmapCommit(struct wiringXRegmap_t *);
+int wiringXRegmapSync(struct wiringXRegmap_t *);
+int wiringXRegmapInvalidate(struct wiringXRegmap_t *);
+int wiringXRegmapStats(struct wiringXRegmap_t *, struct wiringXRegmapStats_t *);
+void wiringXRegmapGC(struct wiringXRegmap_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
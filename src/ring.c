@@ -0,0 +1,145 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wiringx.h"
+#include "ring.h"
+
+int ring_init(struct ring_t *ring, size_t elem_size, size_t count) {
+	size_t size = 1;
+
+	/* Round up so indexes can be masked */
+	while(size < count) {
+		size <<= 1;
+	}
+
+	if((ring->buffer = malloc(elem_size*size)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	ring->elem_size = elem_size;
+	ring->size = size;
+	ring->mask = size-1;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return 0;
+}
+
+static void ring_copy_in(struct ring_t *ring, size_t pos, const unsigned char *in, size_t count) {
+	size_t idx = pos & ring->mask;
+	size_t first = ring->size - idx;
+
+	if(first > count) {
+		first = count;
+	}
+	memcpy(&ring->buffer[idx*ring->elem_size], in, first*ring->elem_size);
+	if(count > first) {
+		memcpy(ring->buffer, &in[first*ring->elem_size], (count-first)*ring->elem_size);
+	}
+}
+
+static void ring_copy_out(struct ring_t *ring, size_t pos, unsigned char *out, size_t count) {
+	size_t idx = pos & ring->mask;
+	size_t first = ring->size - idx;
+
+	if(first > count) {
+		first = count;
+	}
+	memcpy(out, &ring->buffer[idx*ring->elem_size], first*ring->elem_size);
+	if(count > first) {
+		memcpy(&out[first*ring->elem_size], ring->buffer, (count-first)*ring->elem_size);
+	}
+}
+
+/*
+ * Returns the number of elements actually
+ * stored, which is less than count when
+ * the ring is (nearly) full.
+ */
+size_t ring_push(struct ring_t *ring, const void *elems, size_t count) {
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t space = ring->size - (head - tail);
+
+	if(count > space) {
+		count = space;
+	}
+	if(count == 0) {
+		return 0;
+	}
+	ring_copy_in(ring, head, elems, count);
+	__atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+size_t ring_pop(struct ring_t *ring, void *elems, size_t count) {
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	size_t avail = head - tail;
+
+	if(count > avail) {
+		count = avail;
+	}
+	if(count == 0) {
+		return 0;
+	}
+	ring_copy_out(ring, tail, elems, count);
+	__atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+/*
+ * Returns the largest contiguous free area and
+ * its size in elements, so the producer can fill
+ * it in place, e.g. with read(). Nothing becomes
+ * visible to the consumer until ring_commit.
+ */
+void *ring_reserve(struct ring_t *ring, size_t *count) {
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t space = ring->size - (head - tail);
+	size_t idx = head & ring->mask;
+
+	if(space > ring->size - idx) {
+		space = ring->size - idx;
+	}
+	*count = space;
+
+	return &ring->buffer[idx*ring->elem_size];
+}
+
+void ring_commit(struct ring_t *ring, size_t count) {
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	__atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+}
+
+size_t ring_count(struct ring_t *ring) {
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	return head - tail;
+}
+
+size_t ring_free(struct ring_t *ring) {
+	return ring->size - ring_count(ring);
+}
+
+void ring_gc(struct ring_t *ring) {
+	if(ring->buffer != NULL) {
+		free(ring->buffer);
+		ring->buffer = NULL;
+	}
+	ring->size = 0;
+	ring->head = 0;
+	ring->tail = 0;
+}
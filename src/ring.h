@@ -0,0 +1,37 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_RING_H_
+#define _WIRINGX_RING_H_
+
+#include <stddef.h>
+
+/*
+ * Single producer, single consumer ring of
+ * fixed size elements. The producer only
+ * writes head, the consumer only writes tail.
+ */
+typedef struct ring_t {
+	unsigned char *buffer;
+	size_t elem_size;
+	size_t size;
+	size_t mask;
+	size_t head;
+	size_t tail;
+} ring_t;
+
+int ring_init(struct ring_t *, size_t elem_size, size_t count);
+size_t ring_push(struct ring_t *, const void *elems, size_t count);
+size_t ring_pop(struct ring_t *, void *elems, size_t count);
+void *ring_reserve(struct ring_t *, size_t *count);
+void ring_commit(struct ring_t *, size_t count);
+size_t ring_count(struct ring_t *);
+size_t ring_free(struct ring_t *);
+void ring_gc(struct ring_t *);
+
+#endif
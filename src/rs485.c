@@ -0,0 +1,242 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+#include "wiringx.h"
+#include "rs485.h"
+
+typedef struct rs485_t {
+	enum rs485_mode_t mode;
+	int gpio;
+	int active;
+	unsigned int delay_before_us;
+	unsigned int delay_after_us;
+	/* Time on the wire of a single character */
+	uint64_t char_ns;
+} rs485_t;
+
+static pthread_mutex_t rs485_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rs485_t *rs485 = NULL;
+static int rs485_size = 0;
+
+static uint64_t rs485_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void rs485_sleep_until(uint64_t deadline) {
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+	ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+static int rs485_kernel(int fd, struct wiringXRS485_t *config) {
+	struct serial_rs485 conf;
+
+	memset(&conf, 0, sizeof(conf));
+	conf.flags = SER_RS485_ENABLED;
+	if(config->active == HIGH) {
+		conf.flags |= SER_RS485_RTS_ON_SEND;
+	} else {
+		conf.flags |= SER_RS485_RTS_AFTER_SEND;
+	}
+	/* The kernel takes milliseconds, round up */
+	conf.delay_rts_before_send = (config->delay_before_us + 999) / 1000;
+	conf.delay_rts_after_send = (config->delay_after_us + 999) / 1000;
+
+	return ioctl(fd, TIOCSRS485, &conf);
+}
+
+static void rs485_store(int fd, struct rs485_t *tmp) {
+	pthread_mutex_lock(&rs485_lock);
+	if(fd >= rs485_size) {
+		if((rs485 = realloc(rs485, sizeof(struct rs485_t)*(fd+1))) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		memset(&rs485[rs485_size], 0, sizeof(struct rs485_t)*(fd+1-rs485_size));
+		rs485_size = fd+1;
+	}
+	memcpy(&rs485[fd], tmp, sizeof(struct rs485_t));
+	pthread_mutex_unlock(&rs485_lock);
+}
+
+/* Copies the setup of fd, the table may move once unlocked */
+static enum rs485_mode_t rs485_load(int fd, struct rs485_t *tmp) {
+	memset(tmp, 0, sizeof(struct rs485_t));
+
+	pthread_mutex_lock(&rs485_lock);
+	if(fd > 0 && fd < rs485_size) {
+		memcpy(tmp, &rs485[fd], sizeof(struct rs485_t));
+	}
+	pthread_mutex_unlock(&rs485_lock);
+
+	return tmp->mode;
+}
+
+void rs485_close(int fd) {
+	pthread_mutex_lock(&rs485_lock);
+	if(fd > 0 && fd < rs485_size) {
+		memset(&rs485[fd], 0, sizeof(struct rs485_t));
+	}
+	pthread_mutex_unlock(&rs485_lock);
+}
+
+/*
+ * Switches a serial port to RS-485 half duplex. The
+ * UART driver toggles RTS itself when it supports
+ * TIOCSRS485, otherwise wiringXSerialRS485Write
+ * drives the given GPIO, which must already be
+ * setup as an output.
+ */
+EXPORT int wiringXSerialRS485(int fd, struct wiringXRS485_t config) {
+	struct rs485_t setup, *tmp = &setup;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+
+	/* Whatever happens below, the previous setup is gone */
+	memset(tmp, 0, sizeof(struct rs485_t));
+	rs485_store(fd, tmp);
+
+	if(config.force_gpio == 0 && rs485_kernel(fd, &config) == 0) {
+		tmp->mode = RS485_MODE_KERNEL;
+		rs485_store(fd, tmp);
+		return RS485_MODE_KERNEL;
+	}
+
+	if(config.gpio < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial driver does not support RS-485 (%s) and no direction GPIO was given", strerror(errno));
+		return -1;
+	}
+	if(wiringXValidGPIO(config.gpio) != 0) {
+		wiringXLog(LOG_ERR, "wiringX RS-485 direction GPIO %d is not valid", config.gpio);
+		return -1;
+	}
+	if((tmp->char_ns = wiringXSerialCharTime(fd)) == 0) {
+		wiringXLog(LOG_ERR, "wiringX could not determine the serial character time");
+		return -1;
+	}
+
+	tmp->gpio = config.gpio;
+	tmp->active = (config.active == HIGH) ? HIGH : LOW;
+	tmp->delay_before_us = config.delay_before_us;
+	tmp->delay_after_us = config.delay_after_us;
+	tmp->mode = RS485_MODE_GPIO;
+
+	digitalWrite(tmp->gpio, (tmp->active == HIGH) ? LOW : HIGH);
+	rs485_store(fd, tmp);
+
+	return RS485_MODE_GPIO;
+}
+
+EXPORT int wiringXSerialRS485Disable(int fd) {
+	struct serial_rs485 conf;
+	enum rs485_mode_t mode = RS485_MODE_OFF;
+
+	pthread_mutex_lock(&rs485_lock);
+	if(fd > 0 && fd < rs485_size) {
+		mode = rs485[fd].mode;
+		rs485[fd].mode = RS485_MODE_OFF;
+	}
+	pthread_mutex_unlock(&rs485_lock);
+
+	if(mode == RS485_MODE_OFF) {
+		return -1;
+	}
+	if(mode == RS485_MODE_KERNEL) {
+		memset(&conf, 0, sizeof(conf));
+		ioctl(fd, TIOCSRS485, &conf);
+	}
+
+	return 0;
+}
+
+/*
+ * Waits until the last stop bit left the UART. The
+ * estimate is based on the character time, after
+ * which the line status register is polled for an
+ * empty transmitter when the driver exposes it.
+ */
+static void rs485_wait_sent(int fd, struct rs485_t *tmp, uint64_t start, size_t len) {
+	uint64_t end = 0, alt = 0, limit = 0;
+	unsigned int lsr = 0;
+	int queued = 0;
+
+	end = start + (uint64_t)len * tmp->char_ns;
+	if(ioctl(fd, TIOCOUTQ, &queued) == 0 && queued > 0) {
+		alt = rs485_now() + (uint64_t)queued * tmp->char_ns;
+		if(alt > end) {
+			end = alt;
+		}
+	}
+
+	/* Sleep most of it, the scheduler is not precise enough for the rest */
+	if(end > rs485_now() + 2*tmp->char_ns) {
+		rs485_sleep_until(end - tmp->char_ns);
+	}
+
+	if(ioctl(fd, TIOCSERGETLSR, &lsr) == 0) {
+		/* Never spin longer than a few characters past the estimate */
+		limit = end + 4*tmp->char_ns;
+		while((lsr & TIOCSER_TEMT) == 0 && rs485_now() < limit) {
+			if(ioctl(fd, TIOCSERGETLSR, &lsr) < 0) {
+				break;
+			}
+		}
+	} else {
+		while(rs485_now() < end);
+	}
+}
+
+EXPORT int wiringXSerialRS485Write(int fd, const void *buf, size_t len) {
+	struct rs485_t setup, *tmp = &setup;
+	uint64_t start = 0;
+	int ret = 0;
+
+	if(rs485_load(fd, tmp) != RS485_MODE_GPIO) {
+		return wiringXSerialWrite(fd, buf, len);
+	}
+
+	digitalWrite(tmp->gpio, (tmp->active == HIGH) ? HIGH : LOW);
+	if(tmp->delay_before_us > 0) {
+		rs485_sleep_until(rs485_now() + (uint64_t)tmp->delay_before_us*1000ULL);
+	}
+
+	start = rs485_now();
+	ret = wiringXSerialWrite(fd, buf, len);
+	if(ret > 0) {
+		rs485_wait_sent(fd, tmp, start, (size_t)ret);
+	}
+
+	if(tmp->delay_after_us > 0) {
+		rs485_sleep_until(rs485_now() + (uint64_t)tmp->delay_after_us*1000ULL);
+	}
+	digitalWrite(tmp->gpio, (tmp->active == HIGH) ? LOW : HIGH);
+
+	return ret;
+}
+
+#endif
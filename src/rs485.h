@@ -0,0 +1,15 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_RS485_H_
+#define _WIRINGX_RS485_H_
+
+/* Forgets the RS-485 setup of a serial fd that is being closed */
+void rs485_close(int fd);
+
+#endif
@@ -0,0 +1,322 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+
+#include "wiringx.h"
+#include "serial-capture.h"
+
+/* Largest chunk moved per splice, the default pipe size */
+#define SERIAL_CAPTURE_CHUNK	65536
+
+typedef struct wiringXSerialCapture_t {
+	int fd;
+	int out;
+	int index;
+	int stopfd;
+	int pipe[2];
+	pthread_t thread;
+
+	uint64_t interval;
+	uint64_t next;
+	uint64_t offset;
+	/* Set once the kernel refused to splice either end */
+	int copy;
+
+	struct wiringXSerialCaptureStats_t stats;
+
+	unsigned char scratch[4096];
+} wiringXSerialCapture_t;
+
+static uint64_t serial_capture_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int serial_capture_write(int fd, const void *buf, size_t len) {
+	const unsigned char *p = buf;
+	size_t done = 0;
+	ssize_t n = 0;
+
+	while(done < len) {
+		if((n = write(fd, &p[done], len - done)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ * Moves up to len bytes from fd to the output through
+ * the scratch buffer, stopping at the first short read.
+ */
+static ssize_t serial_capture_copy(struct wiringXSerialCapture_t *cap, int fd, size_t len) {
+	size_t done = 0, chunk = 0;
+	ssize_t n = 0;
+
+	while(done < len) {
+		chunk = (len - done < sizeof(cap->scratch)) ? len - done : sizeof(cap->scratch);
+		if((n = read(fd, cap->scratch, chunk)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EAGAIN) {
+				break;
+			}
+			return -1;
+		} else if(n == 0) {
+			break;
+		}
+		if(serial_capture_write(cap->out, cap->scratch, (size_t)n) != 0) {
+			return -1;
+		}
+		done += (size_t)n;
+		/* Drained, another read could block */
+		if((size_t)n < chunk) {
+			break;
+		}
+	}
+	__atomic_add_fetch(&cap->stats.copied, done, __ATOMIC_RELAXED);
+
+	return (ssize_t)done;
+}
+
+/*
+ * The serial data goes into the pipe and from there
+ * into the output, without passing through user
+ * space. Drivers or outputs that do not support
+ * splice, e.g. files opened with O_APPEND, make the
+ * capture fall back to plain reads and writes.
+ */
+static ssize_t serial_capture_move(struct wiringXSerialCapture_t *cap) {
+	ssize_t n = 0, m = 0, left = 0;
+
+	if(cap->copy == 1) {
+		return serial_capture_copy(cap, cap->fd, sizeof(cap->scratch));
+	}
+
+	if((n = splice(cap->fd, NULL, cap->pipe[1], NULL, SERIAL_CAPTURE_CHUNK, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) < 0) {
+		if(errno == EINTR || errno == EAGAIN) {
+			return 0;
+		}
+		if(errno == EINVAL || errno == ENOSYS) {
+			wiringXLog(LOG_NOTICE, "wiringX serial capture can not splice from this port, copying instead");
+			cap->copy = 1;
+			return serial_capture_copy(cap, cap->fd, sizeof(cap->scratch));
+		}
+		return -1;
+	}
+
+	left = n;
+	while(left > 0) {
+		if((m = splice(cap->pipe[0], NULL, cap->out, NULL, (size_t)left, SPLICE_F_MOVE)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EINVAL || errno == ENOSYS) {
+				wiringXLog(LOG_NOTICE, "wiringX serial capture can not splice to this output, copying instead");
+				cap->copy = 1;
+				if(serial_capture_copy(cap, cap->pipe[0], (size_t)left) != left) {
+					return -1;
+				}
+				break;
+			}
+			return -1;
+		}
+		left -= m;
+	}
+
+	return n;
+}
+
+static void serial_capture_index(struct wiringXSerialCapture_t *cap, uint64_t now) {
+	struct wiringXSerialCaptureIndex_t record;
+
+	record.offset = cap->offset;
+	record.timestamp_ns = now;
+
+	if(serial_capture_write(cap->index, &record, sizeof(record)) == 0) {
+		__atomic_add_fetch(&cap->stats.records, 1, __ATOMIC_RELAXED);
+	}
+	cap->next = now + cap->interval;
+}
+
+static void *serial_capture_thread(void *param) {
+	struct wiringXSerialCapture_t *cap = param;
+	struct pollfd fds[2];
+	uint64_t now = 0;
+	ssize_t n = 0;
+
+	fds[0].fd = cap->fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = cap->stopfd;
+	fds[1].events = POLLIN;
+
+	while(1) {
+		if(poll(fds, 2, -1) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			wiringXLog(LOG_ERR, "wiringX serial capture failed to wait for data (%s)", strerror(errno));
+			break;
+		}
+		if(fds[1].revents != 0) {
+			break;
+		}
+		if((fds[0].revents & POLLIN) == 0) {
+			if((fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) != 0) {
+				wiringXLog(LOG_ERR, "wiringX serial capture lost its serial port");
+				break;
+			}
+			continue;
+		}
+
+		/* Taken before the data is moved, so it is close to its arrival */
+		now = serial_capture_now();
+		if((n = serial_capture_move(cap)) < 0) {
+			wiringXLog(LOG_ERR, "wiringX serial capture failed (%s)", strerror(errno));
+			break;
+		} else if(n == 0) {
+			continue;
+		}
+
+		if(cap->index >= 0 && now >= cap->next) {
+			serial_capture_index(cap, now);
+		}
+		cap->offset += (uint64_t)n;
+		__atomic_add_fetch(&cap->stats.bytes, (uint64_t)n, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&cap->stats.chunks, 1, __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+/*
+ * Captures everything received on an opened serial
+ * port into out, a file or pipe, until the capture is
+ * stopped. When index is a valid descriptor an index
+ * record is written for the first chunk received
+ * after every interval milliseconds, 0 writes one
+ * per chunk.
+ */
+EXPORT struct wiringXSerialCapture_t *wiringXSerialCaptureStart(int fd, int out, int index, unsigned int interval, int priority) {
+	struct wiringXSerialCapture_t *cap = NULL;
+	struct sched_param param;
+	pthread_attr_t attr;
+	int ret = 0;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return NULL;
+	}
+	if(out < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial capture needs an output");
+		return NULL;
+	}
+
+	if((cap = malloc(sizeof(struct wiringXSerialCapture_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(cap, 0, sizeof(struct wiringXSerialCapture_t));
+
+	cap->fd = fd;
+	cap->out = out;
+	cap->index = index;
+	cap->interval = (uint64_t)interval * 1000000ULL;
+
+	if(pipe2(cap->pipe, O_CLOEXEC) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial capture failed to create a pipe (%s)", strerror(errno));
+		free(cap);
+		return NULL;
+	}
+	if((cap->stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial capture failed to create an eventfd (%s)", strerror(errno));
+		close(cap->pipe[0]);
+		close(cap->pipe[1]);
+		free(cap);
+		return NULL;
+	}
+
+	pthread_attr_init(&attr);
+	if(priority > 0) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+	if((ret = pthread_create(&cap->thread, &attr, serial_capture_thread, cap)) != 0 && priority > 0) {
+		wiringXLog(LOG_WARNING, "wiringX serial capture could not get realtime priority %d, running at default priority", priority);
+		pthread_attr_destroy(&attr);
+		pthread_attr_init(&attr);
+		ret = pthread_create(&cap->thread, &attr, serial_capture_thread, cap);
+	}
+	pthread_attr_destroy(&attr);
+
+	if(ret != 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to start the serial capture thread (%s)", strerror(ret));
+		close(cap->stopfd);
+		close(cap->pipe[0]);
+		close(cap->pipe[1]);
+		free(cap);
+		return NULL;
+	}
+
+	return cap;
+}
+
+EXPORT int wiringXSerialCaptureStats(struct wiringXSerialCapture_t *cap, struct wiringXSerialCaptureStats_t *stats) {
+	if(cap == NULL || stats == NULL) {
+		return -1;
+	}
+
+	stats->bytes = __atomic_load_n(&cap->stats.bytes, __ATOMIC_RELAXED);
+	stats->chunks = __atomic_load_n(&cap->stats.chunks, __ATOMIC_RELAXED);
+	stats->records = __atomic_load_n(&cap->stats.records, __ATOMIC_RELAXED);
+	stats->copied = __atomic_load_n(&cap->stats.copied, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+/* The serial port, output and index stay open */
+EXPORT int wiringXSerialCaptureStop(struct wiringXSerialCapture_t *cap) {
+	if(cap == NULL) {
+		return -1;
+	}
+
+	eventfd_write(cap->stopfd, 1);
+	pthread_join(cap->thread, NULL);
+
+	close(cap->stopfd);
+	close(cap->pipe[0]);
+	close(cap->pipe[1]);
+	free(cap);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_SERIAL_CAPTURE_H_
+#define _WIRINGX_SERIAL_CAPTURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "wiringx.h"
+
+/*
+ * Written to the index file, in host byte order. The
+ * offset is relative to the start of the capture and
+ * the timestamp is CLOCK_MONOTONIC in nanoseconds.
+ */
+typedef struct wiringXSerialCaptureIndex_t {
+	uint64_t offset;
+	uint64_t timestamp_ns;
+} wiringXSerialCaptureIndex_t;
+
+typedef struct wiringXSerialCaptureStats_t {
+	uint64_t bytes;
+	uint64_t chunks;
+	uint64_t records;
+	/* Bytes that went through user space because splice was refused */
+	uint64_t copied;
+} wiringXSerialCaptureStats_t;
+
+struct wiringXSerialCapture_t;
+
+struct wiringXSerialCapture_t *wiringXSerialCaptureStart(int fd, int out, int index, unsigned int interval, int priority);
+int wiringXSerialCaptureStats(struct wiringXSerialCapture_t *, struct wiringXSerialCaptureStats_t *);
+int wiringXSerialCaptureStop(struct wiringXSerialCapture_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,404 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/serial.h>
+
+#include "wiringx.h"
+#include "stats.h"
+#include "ring.h"
+#include "serial-reader.h"
+
+#define SERIAL_READER_EVENTS	16
+
+typedef struct serial_port_t {
+	int fd;
+	int efd;
+	int active;
+	struct ring_t ring;
+	wiringXSerialReaderCallback_t callback;
+	void *userdata;
+
+	/* Moment the oldest unread data was stored, 0 when there is none */
+	uint64_t pending;
+	uint64_t latency;
+	uint64_t reads;
+
+	struct wiringXSerialReaderStats_t stats;
+} serial_port_t;
+
+typedef struct wiringXSerialReader_t {
+	int epfd;
+	int stopfd;
+	pthread_t thread;
+
+	/* Held while the thread handles events and while ports change */
+	pthread_mutex_t lock;
+	struct serial_port_t *ports[SERIAL_READER_MAX_PORTS];
+
+	unsigned char scratch[4096];
+} wiringXSerialReader_t;
+
+static uint64_t serial_reader_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void serial_reader_mark(struct serial_port_t *port) {
+	uint64_t zero = 0;
+	__atomic_compare_exchange_n(&port->pending, &zero, serial_reader_now(), 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/*
+ * Reads straight into the ring until the port is
+ * drained. Data that does not fit anymore is still
+ * read, so the port does not stay readable, but it
+ * is dropped and counted as an overrun.
+ */
+static void serial_reader_drain(struct wiringXSerialReader_t *reader, int idx) {
+	struct serial_port_t *port = reader->ports[idx];
+	unsigned char *ptr = NULL;
+	size_t space = 0, got = 0;
+	ssize_t n = 0;
+	int full = 0;
+
+	while(1) {
+		ptr = ring_reserve(&port->ring, &space);
+		full = (space == 0);
+		if(full == 1) {
+			ptr = reader->scratch;
+			space = sizeof(reader->scratch);
+		}
+
+		if((n = read(port->fd, ptr, space)) <= 0) {
+			if(n < 0 && errno == EINTR) {
+				continue;
+			}
+			if(n == 0 || errno != EAGAIN) {
+				STATS_SERIAL(port->fd, -1, 0, 0);
+				wiringXLog(LOG_WARNING, "wiringX serial reader stopped reading port %d (%s)", idx, (n == 0) ? "hangup" : strerror(errno));
+				epoll_ctl(reader->epfd, EPOLL_CTL_DEL, port->fd, NULL);
+				port->active = 0;
+			}
+			break;
+		}
+
+		__atomic_add_fetch(&port->stats.chunks, 1, __ATOMIC_RELAXED);
+		STATS_SERIAL(port->fd, 0, 0, n);
+		if(full == 1) {
+			__atomic_add_fetch(&port->stats.overruns, (uint64_t)n, __ATOMIC_RELAXED);
+		} else {
+			ring_commit(&port->ring, (size_t)n);
+			__atomic_add_fetch(&port->stats.bytes, (uint64_t)n, __ATOMIC_RELAXED);
+			got += (size_t)n;
+		}
+
+		/* A short read means the driver buffer is empty */
+		if((size_t)n < space) {
+			break;
+		}
+	}
+
+	if(got > 0) {
+		serial_reader_mark(port);
+		if(port->callback != NULL) {
+			port->callback(idx, port->userdata);
+		} else {
+			eventfd_write(port->efd, 1);
+		}
+	}
+}
+
+static void *serial_reader_thread(void *param) {
+	struct wiringXSerialReader_t *reader = param;
+	struct epoll_event events[SERIAL_READER_EVENTS];
+	int n = 0, i = 0, idx = 0;
+
+	while(1) {
+		if((n = epoll_wait(reader->epfd, events, SERIAL_READER_EVENTS, -1)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			wiringXLog(LOG_ERR, "wiringX serial reader failed to wait for events (%s)", strerror(errno));
+			break;
+		}
+
+		pthread_mutex_lock(&reader->lock);
+		for(i=0;i<n;i++) {
+			idx = (int)events[i].data.u32;
+			if(idx == SERIAL_READER_MAX_PORTS) {
+				pthread_mutex_unlock(&reader->lock);
+				return NULL;
+			}
+			/* The port may have been removed since epoll_wait returned */
+			if(reader->ports[idx] != NULL && reader->ports[idx]->active == 1) {
+				serial_reader_drain(reader, idx);
+			}
+		}
+		pthread_mutex_unlock(&reader->lock);
+	}
+
+	return NULL;
+}
+
+EXPORT struct wiringXSerialReader_t *wiringXSerialReaderStart(int priority) {
+	struct wiringXSerialReader_t *reader = NULL;
+	struct epoll_event ev;
+	struct sched_param param;
+	pthread_attr_t attr;
+	int ret = 0;
+
+	if((reader = malloc(sizeof(struct wiringXSerialReader_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(reader, 0, sizeof(struct wiringXSerialReader_t));
+	pthread_mutex_init(&reader->lock, NULL);
+
+	if((reader->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial reader failed to create an epoll instance (%s)", strerror(errno));
+		free(reader);
+		return NULL;
+	}
+	if((reader->stopfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial reader failed to create an eventfd (%s)", strerror(errno));
+		close(reader->epfd);
+		free(reader);
+		return NULL;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = SERIAL_READER_MAX_PORTS;
+	epoll_ctl(reader->epfd, EPOLL_CTL_ADD, reader->stopfd, &ev);
+
+	pthread_attr_init(&attr);
+	if(priority > 0) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+	if((ret = pthread_create(&reader->thread, &attr, serial_reader_thread, reader)) != 0 && priority > 0) {
+		wiringXLog(LOG_WARNING, "wiringX serial reader could not get realtime priority %d, running at default priority", priority);
+		pthread_attr_destroy(&attr);
+		pthread_attr_init(&attr);
+		ret = pthread_create(&reader->thread, &attr, serial_reader_thread, reader);
+	}
+	pthread_attr_destroy(&attr);
+
+	if(ret != 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to start the serial reader thread (%s)", strerror(ret));
+		close(reader->stopfd);
+		close(reader->epfd);
+		free(reader);
+		return NULL;
+	}
+
+	return reader;
+}
+
+/*
+ * Adds an opened serial port and returns its port
+ * number. Without a callback the consumer waits on
+ * wiringXSerialReaderEventFd. Callbacks run on the
+ * reader thread and must not add or remove ports.
+ */
+EXPORT int wiringXSerialReaderAdd(struct wiringXSerialReader_t *reader, int fd, size_t ring_size, wiringXSerialReaderCallback_t callback, void *userdata) {
+	struct serial_port_t *port = NULL;
+	struct epoll_event ev;
+	int idx = 0, flags = 0;
+
+	if(reader == NULL || fd <= 0) {
+		return -1;
+	}
+
+	if((port = malloc(sizeof(struct serial_port_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(port, 0, sizeof(struct serial_port_t));
+
+	if((port->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial reader failed to create an eventfd (%s)", strerror(errno));
+		free(port);
+		return -1;
+	}
+	port->fd = fd;
+	port->active = 1;
+	port->callback = callback;
+	port->userdata = userdata;
+	ring_init(&port->ring, 1, (ring_size == 0) ? 65536 : ring_size);
+
+	if((flags = fcntl(fd, F_GETFL)) >= 0) {
+		fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+	}
+
+	pthread_mutex_lock(&reader->lock);
+	for(idx=0;idx<SERIAL_READER_MAX_PORTS;idx++) {
+		if(reader->ports[idx] == NULL) {
+			break;
+		}
+	}
+	if(idx == SERIAL_READER_MAX_PORTS) {
+		pthread_mutex_unlock(&reader->lock);
+		wiringXLog(LOG_ERR, "wiringX serial reader can handle at most %d ports", SERIAL_READER_MAX_PORTS);
+		ring_gc(&port->ring);
+		close(port->efd);
+		free(port);
+		return -1;
+	}
+	reader->ports[idx] = port;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.u32 = (uint32_t)idx;
+	if(epoll_ctl(reader->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+		reader->ports[idx] = NULL;
+		pthread_mutex_unlock(&reader->lock);
+		wiringXLog(LOG_ERR, "wiringX serial reader failed to watch fd %d (%s)", fd, strerror(errno));
+		ring_gc(&port->ring);
+		close(port->efd);
+		free(port);
+		return -1;
+	}
+	pthread_mutex_unlock(&reader->lock);
+
+	return idx;
+}
+
+/* The serial fd itself stays open and belongs to the caller */
+EXPORT int wiringXSerialReaderRemove(struct wiringXSerialReader_t *reader, int port) {
+	struct serial_port_t *tmp = NULL;
+
+	if(reader == NULL || port < 0 || port >= SERIAL_READER_MAX_PORTS) {
+		return -1;
+	}
+
+	pthread_mutex_lock(&reader->lock);
+	if((tmp = reader->ports[port]) == NULL) {
+		pthread_mutex_unlock(&reader->lock);
+		return -1;
+	}
+	if(tmp->active == 1) {
+		epoll_ctl(reader->epfd, EPOLL_CTL_DEL, tmp->fd, NULL);
+	}
+	reader->ports[port] = NULL;
+	pthread_mutex_unlock(&reader->lock);
+
+	ring_gc(&tmp->ring);
+	close(tmp->efd);
+	free(tmp);
+
+	return 0;
+}
+
+EXPORT int wiringXSerialReaderRead(struct wiringXSerialReader_t *reader, int port, void *buf, size_t len) {
+	struct serial_port_t *tmp = NULL;
+	uint64_t since = 0, late = 0;
+	size_t n = 0;
+
+	if(reader == NULL || port < 0 || port >= SERIAL_READER_MAX_PORTS || (tmp = reader->ports[port]) == NULL) {
+		return -1;
+	}
+
+	since = __atomic_exchange_n(&tmp->pending, 0, __ATOMIC_ACQ_REL);
+	n = ring_pop(&tmp->ring, buf, len);
+
+	if(since > 0 && n > 0) {
+		late = serial_reader_now() - since;
+		__atomic_add_fetch(&tmp->latency, late, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&tmp->reads, 1, __ATOMIC_RELAXED);
+		if(late > tmp->stats.max_latency_ns) {
+			__atomic_store_n(&tmp->stats.max_latency_ns, late, __ATOMIC_RELAXED);
+		}
+	}
+	if(ring_count(&tmp->ring) > 0) {
+		serial_reader_mark(tmp);
+	}
+
+	return (int)n;
+}
+
+/* Becomes readable when new data arrived, read it to clear it */
+EXPORT int wiringXSerialReaderEventFd(struct wiringXSerialReader_t *reader, int port) {
+	if(reader == NULL || port < 0 || port >= SERIAL_READER_MAX_PORTS || reader->ports[port] == NULL) {
+		return -1;
+	}
+	return reader->ports[port]->efd;
+}
+
+EXPORT int wiringXSerialReaderStats(struct wiringXSerialReader_t *reader, int port, struct wiringXSerialReaderStats_t *stats) {
+	struct serial_icounter_struct icount;
+	struct serial_port_t *tmp = NULL;
+	uint64_t reads = 0;
+
+	if(reader == NULL || port < 0 || port >= SERIAL_READER_MAX_PORTS || (tmp = reader->ports[port]) == NULL) {
+		return -1;
+	}
+
+	stats->bytes = __atomic_load_n(&tmp->stats.bytes, __ATOMIC_RELAXED);
+	stats->chunks = __atomic_load_n(&tmp->stats.chunks, __ATOMIC_RELAXED);
+	stats->overruns = __atomic_load_n(&tmp->stats.overruns, __ATOMIC_RELAXED);
+	stats->max_latency_ns = __atomic_load_n(&tmp->stats.max_latency_ns, __ATOMIC_RELAXED);
+
+	reads = __atomic_load_n(&tmp->reads, __ATOMIC_RELAXED);
+	stats->avg_latency_ns = (reads > 0) ? __atomic_load_n(&tmp->latency, __ATOMIC_RELAXED) / reads : 0;
+
+	memset(&icount, 0, sizeof(icount));
+	if(ioctl(tmp->fd, TIOCGICOUNT, &icount) == 0) {
+		stats->hw_overruns = (uint64_t)icount.overrun + (uint64_t)icount.buf_overrun;
+	} else {
+		stats->hw_overruns = 0;
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXSerialReaderStop(struct wiringXSerialReader_t *reader) {
+	int i = 0;
+
+	if(reader == NULL) {
+		return -1;
+	}
+
+	eventfd_write(reader->stopfd, 1);
+	pthread_join(reader->thread, NULL);
+
+	for(i=0;i<SERIAL_READER_MAX_PORTS;i++) {
+		if(reader->ports[i] != NULL) {
+			ring_gc(&reader->ports[i]->ring);
+			close(reader->ports[i]->efd);
+			free(reader->ports[i]);
+		}
+	}
+
+	close(reader->stopfd);
+	close(reader->epfd);
+	pthread_mutex_destroy(&reader->lock);
+	free(reader);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_SERIAL_READER_H_
+#define _WIRINGX_SERIAL_READER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wiringx.h"
+
+#define SERIAL_READER_MAX_PORTS	64
+
+/* Called from the reader thread after new data was stored */
+typedef void (*wiringXSerialReaderCallback_t)(int port, void *userdata);
+
+typedef struct wiringXSerialReaderStats_t {
+	uint64_t bytes;
+	/* Number of read() calls that returned data */
+	uint64_t chunks;
+	/* Bytes dropped because the consumer did not drain the ring */
+	uint64_t overruns;
+	/* Overruns counted by the UART driver itself, when it reports them */
+	uint64_t hw_overruns;
+	/* Time data waited in the ring before the consumer read it */
+	uint64_t avg_latency_ns;
+	uint64_t max_latency_ns;
+} wiringXSerialReaderStats_t;
+
+struct wiringXSerialReader_t;
+
+struct wiringXSerialReader_t *wiringXSerialReaderStart(int priority);
+int wiringXSerialReaderAdd(struct wiringXSerialReader_t *, int fd, size_t ring_size, wiringXSerialReaderCallback_t, void *userdata);
+int wiringXSerialReaderRemove(struct wiringXSerialReader_t *, int port);
+int wiringXSerialReaderRead(struct wiringXSerialReader_t *, int port, void *buf, size_t len);
+int wiringXSerialReaderEventFd(struct wiringXSerialReader_t *, int port);
+int wiringXSerialReaderStats(struct wiringXSerialReader_t *, int port, struct wiringXSerialReaderStats_t *);
+int wiringXSerialReaderStop(struct wiringXSerialReader_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
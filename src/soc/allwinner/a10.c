@@ -216,12 +216,12 @@ static struct layout_t {
 };
 
 static int allwinnerA10Setup(void) {
-	if((allwinnerA10->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(allwinnerA10) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((allwinnerA10->gpio[0] = (unsigned char *)mmap(0, allwinnerA10->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerA10->fd, allwinnerA10->base_addr[0])) == NULL) {
+	if((allwinnerA10->gpio[0] = soc_mmap(allwinnerA10, allwinnerA10->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerA10->brand, allwinnerA10->chip);
 		return -1;
 	}
@@ -428,7 +428,7 @@ static int allwinnerA10GC(void) {
 		}
 	}
 	if(allwinnerA10->gpio[0] != NULL) {
-		munmap(allwinnerA10->gpio[0], allwinnerA10->page_size);
+		soc_munmap(allwinnerA10, allwinnerA10->gpio[0]);
 	}
 	return 0;
 }
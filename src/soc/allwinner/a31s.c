@@ -207,17 +207,17 @@ static struct layout_t {
 };
 
 static int allwinnerA31sSetup(void) {
-	if((allwinnerA31s->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(allwinnerA31s) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((allwinnerA31s->gpio[0] = (unsigned char *)mmap(0, allwinnerA31s->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerA31s->fd, allwinnerA31s->base_addr[0])) == NULL) {
+	if((allwinnerA31s->gpio[0] = soc_mmap(allwinnerA31s, allwinnerA31s->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerA31s->brand, allwinnerA31s->chip);
 		return -1;
 	}
 
-	if((allwinnerA31s->gpio[1] = (unsigned char *)mmap(0, allwinnerA31s->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerA31s->fd, allwinnerA31s->base_addr[1])) == NULL) {
+	if((allwinnerA31s->gpio[1] = soc_mmap(allwinnerA31s, allwinnerA31s->base_addr[1])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerA31s->brand, allwinnerA31s->chip);
 		return -1;
 	}
@@ -345,10 +345,10 @@ static int allwinnerA31sGC(void) {
 		}
 	}
 	if(allwinnerA31s->gpio[0] != NULL) {
-		munmap(allwinnerA31s->gpio[0], allwinnerA31s->page_size);
+		soc_munmap(allwinnerA31s, allwinnerA31s->gpio[0]);
 	}
 	if(allwinnerA31s->gpio[1] != NULL) {
-		munmap(allwinnerA31s->gpio[1], allwinnerA31s->page_size);
+		soc_munmap(allwinnerA31s, allwinnerA31s->gpio[1]);
 	}
 	return 0;
 }
@@ -156,17 +156,17 @@ static struct layout_t {
 };
 
 static int allwinnerH3Setup(void) {
-	if((allwinnerH3->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(allwinnerH3) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((allwinnerH3->gpio[0] = (unsigned char *)mmap(0, allwinnerH3->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerH3->fd, allwinnerH3->base_addr[0])) == NULL) {
+	if((allwinnerH3->gpio[0] = soc_mmap(allwinnerH3, allwinnerH3->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerH3->brand, allwinnerH3->chip);
 		return -1;
 	}
 
-	if((allwinnerH3->gpio[1] = (unsigned char *)mmap(0, allwinnerH3->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerH3->fd, allwinnerH3->base_addr[1])) == NULL) {
+	if((allwinnerH3->gpio[1] = soc_mmap(allwinnerH3, allwinnerH3->base_addr[1])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerH3->brand, allwinnerH3->chip);
 		return -1;
 	}
@@ -377,7 +377,7 @@ static int allwinnerH3GC(void) {
 		}
 	}
 	if(allwinnerH3->gpio[0] != NULL) {
-		munmap(allwinnerH3->gpio[0], allwinnerH3->page_size);
+		soc_munmap(allwinnerH3, allwinnerH3->gpio[0]);
 	}
 	return 0;
 }
@@ -156,17 +156,17 @@ static struct layout_t {
 };
 
 static int allwinnerH5Setup(void) {
-	if((allwinnerH5->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(allwinnerH5) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((allwinnerH5->gpio[0] = (unsigned char *)mmap(0, allwinnerH5->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerH5->fd, allwinnerH5->base_addr[0])) == NULL) {
+	if((allwinnerH5->gpio[0] = soc_mmap(allwinnerH5, allwinnerH5->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerH5->brand, allwinnerH5->chip);
 		return -1;
 	}
 
-	if((allwinnerH5->gpio[1] = (unsigned char *)mmap(0, allwinnerH5->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, allwinnerH5->fd, allwinnerH5->base_addr[1])) == NULL) {
+	if((allwinnerH5->gpio[1] = soc_mmap(allwinnerH5, allwinnerH5->base_addr[1])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", allwinnerH5->brand, allwinnerH5->chip);
 		return -1;
 	}
@@ -377,7 +377,7 @@ static int allwinnerH5GC(void) {
 		}
 	}
 	if(allwinnerH5->gpio[0] != NULL) {
-		munmap(allwinnerH5->gpio[0], allwinnerH5->page_size);
+		soc_munmap(allwinnerH5, allwinnerH5->gpio[0]);
 	}
 	return 0;
 }
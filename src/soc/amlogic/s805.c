@@ -180,17 +180,17 @@ static struct layout_t {
 };
 
 static int amlogicS805Setup(void) {
-	if((amlogicS805->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(amlogicS805) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((amlogicS805->gpio[0] = (unsigned char *)mmap(0, amlogicS805->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, amlogicS805->fd, amlogicS805->base_addr[0])) == NULL) {
+	if((amlogicS805->gpio[0] = soc_mmap(amlogicS805, amlogicS805->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", amlogicS805->brand, amlogicS805->chip);
 		return -1;
 	}
 
-	if((amlogicS805->gpio[1] = (unsigned char *)mmap(0, amlogicS805->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, amlogicS805->fd, amlogicS805->base_addr[1])) == NULL) {
+	if((amlogicS805->gpio[1] = soc_mmap(amlogicS805, amlogicS805->base_addr[1])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", amlogicS805->brand, amlogicS805->chip);
 		return -1;
 	}
@@ -381,7 +381,7 @@ static int amlogicS805GC(void) {
 		}
 	}
 	if(amlogicS805->gpio[0] != NULL) {
-		munmap(amlogicS805->gpio[0], amlogicS805->page_size);
+		soc_munmap(amlogicS805, amlogicS805->gpio[0]);
 	}
 	return 0;
 }
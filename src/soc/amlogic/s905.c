@@ -183,17 +183,17 @@ static struct layout_t {
 };
 
 static int amlogicS905Setup(void) {
-	if((amlogicS905->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(amlogicS905) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((amlogicS905->gpio[0] = mmap(0, amlogicS905->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, amlogicS905->fd, amlogicS905->base_addr[0])) == MAP_FAILED) {
+	if((amlogicS905->gpio[0] = soc_mmap(amlogicS905, amlogicS905->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", amlogicS905->brand, amlogicS905->chip);
 		return -1;
 	}
 
-	if((amlogicS905->gpio[1] = mmap(0, amlogicS905->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, amlogicS905->fd, amlogicS905->base_addr[1])) == MAP_FAILED) {
+	if((amlogicS905->gpio[1] = soc_mmap(amlogicS905, amlogicS905->base_addr[1])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", amlogicS905->brand, amlogicS905->chip);
 		return -1;
 	}
@@ -385,7 +385,7 @@ static int amlogicS905GC(void) {
 		}
 	}
 	if(amlogicS905->gpio[0] != NULL) {
-		munmap(amlogicS905->gpio[0], amlogicS905->page_size);
+		soc_munmap(amlogicS905, amlogicS905->gpio[0]);
 	}
 	return 0;
 }
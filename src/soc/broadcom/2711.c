@@ -18,6 +18,7 @@
 #include "2711.h"
 #include "../../wiringx.h"
 #include "../soc.h"
+#include "spi0.h"
 
 struct soc_t *broadcom2711 = NULL;
 
@@ -126,16 +127,20 @@ static struct layout_t {
 };
 
 static int broadcom2711Setup(void) {
-	if((broadcom2711->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(broadcom2711) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((broadcom2711->gpio[0] = (unsigned char *)mmap(0, broadcom2711->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, broadcom2711->fd, broadcom2711->base_addr[0])) == NULL) {
+	if((broadcom2711->gpio[0] = soc_mmap(broadcom2711, broadcom2711->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", broadcom2711->brand, broadcom2711->chip);
 		return -1;
 	}
 
+	/* The set and clear registers act on the level registers */
+	soc_sim_rule(broadcom2711, broadcom2711->base_addr[0] + broadcom2711->base_offs[0] + GPSET0, 8, SOC_SIM_SET, broadcom2711->base_addr[0] + broadcom2711->base_offs[0] + GPLEV0);
+	soc_sim_rule(broadcom2711, broadcom2711->base_addr[0] + broadcom2711->base_offs[0] + GPCLR0, 8, SOC_SIM_CLEAR, broadcom2711->base_addr[0] + broadcom2711->base_offs[0] + GPLEV0);
+
 	return 0;
 }
 
@@ -321,12 +326,26 @@ static int broadcom2711GC(void) {
 			}
 		}
 	}
+	broadcomSPI0GC(broadcom2711);
 	if(broadcom2711->gpio[0] != NULL) {
-		munmap(broadcom2711->gpio[0], broadcom2711->page_size);
+		soc_munmap(broadcom2711, broadcom2711->gpio[0]);
 	}
 	return 0;
 }
 
+static int broadcom2711SPISetup(int channel, int speed, unsigned int mode) {
+	/* Default core clock of the Pi 4 */
+	return broadcomSPI0Setup(broadcom2711, channel, speed, mode, 500000000);
+}
+
+static int broadcom2711SPIDataRW(int channel, unsigned char *data, int len) {
+	return broadcomSPI0DataRW(broadcom2711, channel, data, len);
+}
+
+static int broadcom2711SPIRelease(int channel) {
+	return broadcomSPI0Release(broadcom2711, channel);
+}
+
 static int broadcom2711SelectableFd(int i) {
 	struct layout_t *pin = NULL;
 
@@ -357,6 +376,8 @@ void broadcom2711Init(void) {
 	broadcom2711->page_size = (4*1024);
 	broadcom2711->base_addr[0] = 0xFE200000;
 	broadcom2711->base_offs[0] = 0x00000000;
+	broadcom2711->base_addr[1] = 0xFE200000 + BROADCOM_SPI0_OFFSET;
+	broadcom2711->base_offs[1] = 0x00000000;
 
 	broadcom2711->gc = &broadcom2711GC;
 	broadcom2711->selectableFd = &broadcom2711SelectableFd;
@@ -370,4 +391,8 @@ void broadcom2711Init(void) {
 	broadcom2711->setIRQ = &broadcom2711SetIRQ;
 	broadcom2711->isr = &broadcom2711ISR;
 	broadcom2711->waitForInterrupt = &broadcom2711WaitForInterrupt;
+
+	broadcom2711->spiSetup = &broadcom2711SPISetup;
+	broadcom2711->spiDataRW = &broadcom2711SPIDataRW;
+	broadcom2711->spiRelease = &broadcom2711SPIRelease;
 }
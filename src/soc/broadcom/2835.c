@@ -18,6 +18,7 @@
 #include "2835.h"
 #include "../../wiringx.h"
 #include "../soc.h"
+#include "spi0.h"
 
 struct soc_t *broadcom2835 = NULL;
 
@@ -126,16 +127,20 @@ static struct layout_t {
 };
 
 static int broadcom2835Setup(void) {
-	if((broadcom2835->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(broadcom2835) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((broadcom2835->gpio[0] = (unsigned char *)mmap(0, broadcom2835->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, broadcom2835->fd, broadcom2835->base_addr[0])) == NULL) {
+	if((broadcom2835->gpio[0] = soc_mmap(broadcom2835, broadcom2835->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", broadcom2835->brand, broadcom2835->chip);
 		return -1;
 	}
 
+	/* The set and clear registers act on the level registers */
+	soc_sim_rule(broadcom2835, broadcom2835->base_addr[0] + broadcom2835->base_offs[0] + GPSET0, 8, SOC_SIM_SET, broadcom2835->base_addr[0] + broadcom2835->base_offs[0] + GPLEV0);
+	soc_sim_rule(broadcom2835, broadcom2835->base_addr[0] + broadcom2835->base_offs[0] + GPCLR0, 8, SOC_SIM_CLEAR, broadcom2835->base_addr[0] + broadcom2835->base_offs[0] + GPLEV0);
+
 	return 0;
 }
 
@@ -321,12 +326,26 @@ static int broadcom2835GC(void) {
 			}
 		}
 	}
+	broadcomSPI0GC(broadcom2835);
 	if(broadcom2835->gpio[0] != NULL) {
-		munmap(broadcom2835->gpio[0], broadcom2835->page_size);
+		soc_munmap(broadcom2835, broadcom2835->gpio[0]);
 	}
 	return 0;
 }
 
+static int broadcom2835SPISetup(int channel, int speed, unsigned int mode) {
+	/* Default core clock of the Pi 1 and Zero */
+	return broadcomSPI0Setup(broadcom2835, channel, speed, mode, 250000000);
+}
+
+static int broadcom2835SPIDataRW(int channel, unsigned char *data, int len) {
+	return broadcomSPI0DataRW(broadcom2835, channel, data, len);
+}
+
+static int broadcom2835SPIRelease(int channel) {
+	return broadcomSPI0Release(broadcom2835, channel);
+}
+
 static int broadcom2835SelectableFd(int i) {
 	struct layout_t *pin = NULL;
 
@@ -353,6 +372,8 @@ void broadcom2835Init(void) {
 	broadcom2835->page_size = (4*1024);
 	broadcom2835->base_addr[0] = 0x20200000;
 	broadcom2835->base_offs[0] = 0x00000000;
+	broadcom2835->base_addr[1] = 0x20200000 + BROADCOM_SPI0_OFFSET;
+	broadcom2835->base_offs[1] = 0x00000000;
 
 	broadcom2835->gc = &broadcom2835GC;
 	broadcom2835->selectableFd = &broadcom2835SelectableFd;
@@ -366,4 +387,8 @@ void broadcom2835Init(void) {
 	broadcom2835->setIRQ = &broadcom2835SetIRQ;
 	broadcom2835->isr = &broadcom2835ISR;
 	broadcom2835->waitForInterrupt = &broadcom2835WaitForInterrupt;
+
+	broadcom2835->spiSetup = &broadcom2835SPISetup;
+	broadcom2835->spiDataRW = &broadcom2835SPIDataRW;
+	broadcom2835->spiRelease = &broadcom2835SPIRelease;
 }
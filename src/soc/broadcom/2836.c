@@ -18,6 +18,7 @@
 #include "2836.h"
 #include "../../wiringx.h"
 #include "../soc.h"
+#include "spi0.h"
 
 struct soc_t *broadcom2836 = NULL;
 
@@ -126,16 +127,20 @@ static struct layout_t {
 };
 
 static int broadcom2836Setup(void) {
-	if((broadcom2836->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(broadcom2836) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((broadcom2836->gpio[0] = (unsigned char *)mmap(0, broadcom2836->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, broadcom2836->fd, broadcom2836->base_addr[0])) == NULL) {
+	if((broadcom2836->gpio[0] = soc_mmap(broadcom2836, broadcom2836->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", broadcom2836->brand, broadcom2836->chip);
 		return -1;
 	}
 
+	/* The set and clear registers act on the level registers */
+	soc_sim_rule(broadcom2836, broadcom2836->base_addr[0] + broadcom2836->base_offs[0] + GPSET0, 8, SOC_SIM_SET, broadcom2836->base_addr[0] + broadcom2836->base_offs[0] + GPLEV0);
+	soc_sim_rule(broadcom2836, broadcom2836->base_addr[0] + broadcom2836->base_offs[0] + GPCLR0, 8, SOC_SIM_CLEAR, broadcom2836->base_addr[0] + broadcom2836->base_offs[0] + GPLEV0);
+
 	return 0;
 }
 
@@ -321,12 +326,30 @@ static int broadcom2836GC(void) {
 			}
 		}
 	}
+	broadcomSPI0GC(broadcom2836);
 	if(broadcom2836->gpio[0] != NULL) {
-		munmap(broadcom2836->gpio[0], broadcom2836->page_size);
+		soc_munmap(broadcom2836, broadcom2836->gpio[0]);
 	}
 	return 0;
 }
 
+static int broadcom2836SPISetup(int channel, int speed, unsigned int mode) {
+	/*
+	 * The Pi 2 runs the core at 250 MHz and the Pi 3 at
+	 * 400 MHz, assuming the faster one keeps the SPI
+	 * clock at or below the requested speed on both.
+	 */
+	return broadcomSPI0Setup(broadcom2836, channel, speed, mode, 400000000);
+}
+
+static int broadcom2836SPIDataRW(int channel, unsigned char *data, int len) {
+	return broadcomSPI0DataRW(broadcom2836, channel, data, len);
+}
+
+static int broadcom2836SPIRelease(int channel) {
+	return broadcomSPI0Release(broadcom2836, channel);
+}
+
 static int broadcom2836SelectableFd(int i) {
 	struct layout_t *pin = NULL;
 
@@ -357,6 +380,8 @@ void broadcom2836Init(void) {
 	broadcom2836->page_size = (4*1024);
 	broadcom2836->base_addr[0] = 0x3F200000;
 	broadcom2836->base_offs[0] = 0x00000000;
+	broadcom2836->base_addr[1] = 0x3F200000 + BROADCOM_SPI0_OFFSET;
+	broadcom2836->base_offs[1] = 0x00000000;
 
 	broadcom2836->gc = &broadcom2836GC;
 	broadcom2836->selectableFd = &broadcom2836SelectableFd;
@@ -370,4 +395,8 @@ void broadcom2836Init(void) {
 	broadcom2836->setIRQ = &broadcom2836SetIRQ;
 	broadcom2836->isr = &broadcom2836ISR;
 	broadcom2836->waitForInterrupt = &broadcom2836WaitForInterrupt;
+
+	broadcom2836->spiSetup = &broadcom2836SPISetup;
+	broadcom2836->spiDataRW = &broadcom2836SPIDataRW;
+	broadcom2836->spiRelease = &broadcom2836SPIRelease;
 }
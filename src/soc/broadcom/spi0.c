@@ -0,0 +1,287 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "spi0.h"
+#include "../../wiringx.h"
+#include "../soc.h"
+
+/* Register area index of SPI0 in soc->gpio[] */
+#define SPI0_AREA	1
+
+#define SPI0_CS		0x00
+#define SPI0_FIFO	0x04
+#define SPI0_CLK	0x08
+#define SPI0_DLEN	0x0C
+
+#define SPI0_CS_CPHA			(1 << 2)
+#define SPI0_CS_CPOL			(1 << 3)
+#define SPI0_CS_CLEAR_TX	(1 << 4)
+#define SPI0_CS_CLEAR_RX	(1 << 5)
+#define SPI0_CS_CSPOL			(1 << 6)
+#define SPI0_CS_TA				(1 << 7)
+#define SPI0_CS_DONE			(1 << 16)
+#define SPI0_CS_RXD				(1 << 17)
+#define SPI0_CS_TXD				(1 << 18)
+
+/* Give up on a stalled transfer after 100ms */
+#define SPI0_TIMEOUT	100000000LL
+
+/* Firmware mailbox property request for a clock rate */
+#define SPI0_MBOX_PROPERTY			_IOWR(100, 0, char *)
+#define SPI0_MBOX_GET_CLOCK_RATE	0x00030002
+#define SPI0_MBOX_CLOCK_CORE			4
+#define SPI0_MBOX_SUCCESS				0x80000000
+
+static struct {
+	int active;
+	uint32_t cs;
+	uint32_t clk;
+	uint32_t saved_cs;
+	uint32_t saved_clk;
+} spi0[2];
+
+static uintptr_t broadcomSPI0Reg(struct soc_t *soc, unsigned long reg) {
+	return (uintptr_t)soc->gpio[SPI0_AREA] + soc->base_offs[SPI0_AREA] + reg;
+}
+
+static long long broadcomSPI0Now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec*1000000000LL + ts.tv_nsec;
+}
+
+static unsigned long broadcomSPI0ClockDebugfs(void) {
+	char *paths[] = {
+		"/sys/kernel/debug/clk/vpu/clk_rate",
+		"/sys/kernel/debug/clk/fw-clk-core/clk_rate",
+		NULL
+	};
+	char buf[32];
+	unsigned long rate = 0;
+	ssize_t n = 0;
+	int fd = 0, i = 0;
+
+	for(i=0;paths[i]!=NULL && rate==0;i++) {
+		if((fd = open(paths[i], O_RDONLY | O_CLOEXEC)) < 0) {
+			continue;
+		}
+		if((n = read(fd, buf, sizeof(buf)-1)) > 0) {
+			buf[n] = '\0';
+			rate = strtoul(buf, NULL, 10);
+		}
+		close(fd);
+	}
+	return rate;
+}
+
+static unsigned long broadcomSPI0ClockMailbox(void) {
+	uint32_t msg[8] __attribute__((aligned(16)));
+	unsigned long rate = 0;
+	int fd = 0;
+
+	if((fd = open("/dev/vcio", O_RDWR | O_CLOEXEC)) < 0) {
+		return 0;
+	}
+	msg[0] = sizeof(msg);
+	msg[1] = 0;
+	msg[2] = SPI0_MBOX_GET_CLOCK_RATE;
+	msg[3] = 8;
+	msg[4] = 0;
+	msg[5] = SPI0_MBOX_CLOCK_CORE;
+	msg[6] = 0;
+	msg[7] = 0;
+	if(ioctl(fd, SPI0_MBOX_PROPERTY, msg) == 0 && msg[1] == SPI0_MBOX_SUCCESS) {
+		rate = msg[6];
+	}
+	close(fd);
+	return rate;
+}
+
+/*
+ * The SPI0 clock divides the core clock, which the
+ * firmware sets per board and config.txt. Ask the
+ * kernel clock tree first, then the firmware, and
+ * only then trust the default of the platform.
+ */
+static unsigned long broadcomSPI0CoreClock(struct soc_t *soc, unsigned long fallback) {
+	unsigned long rate = 0;
+
+	/* The simulated registers have no clock behind them */
+	if(soc_mem_get() == &soc_mem_sim) {
+		return fallback;
+	}
+	if((rate = broadcomSPI0ClockDebugfs()) > 0) {
+		return rate;
+	}
+	if((rate = broadcomSPI0ClockMailbox()) > 0) {
+		return rate;
+	}
+	wiringXLog(LOG_WARNING, "wiringX could not read the %s %s core clock, assuming %lu Hz for SPI", soc->brand, soc->chip, fallback);
+	return fallback;
+}
+
+int broadcomSPI0Setup(struct soc_t *soc, int channel, int speed, unsigned int mode, unsigned long core_clock) {
+	void *area = NULL;
+	uint32_t cdiv = 0;
+
+	channel &= 1;
+
+	if(soc->fd <= 0 || soc->gpio[0] == NULL) {
+		wiringXLog(LOG_ERR, "The %s %s has not yet been setup by wiringX", soc->brand, soc->chip);
+		return -1;
+	}
+	if((mode & ~(SPIMODE_CPHA | SPIMODE_CPOL | SPIMODE_CS_HIGH)) != 0) {
+		wiringXLog(LOG_ERR, "The %s %s direct SPI driver only supports mode 0 to 3 and CS_HIGH", soc->brand, soc->chip);
+		return -1;
+	}
+	if(speed <= 0) {
+		wiringXLog(LOG_ERR, "The %s %s direct SPI driver needs a speed above zero", soc->brand, soc->chip);
+		return -1;
+	}
+
+	if(soc->gpio[SPI0_AREA] == NULL) {
+		area = soc_mmap(soc, soc->base_addr[SPI0_AREA]);
+		if(area == NULL) {
+			wiringXLog(LOG_ERR, "wiringX failed to map the %s %s SPI0 memory address (%s)", soc->brand, soc->chip, strerror(errno));
+			return -1;
+		}
+		soc->gpio[SPI0_AREA] = area;
+	}
+	if(soc_sim_rule(soc, soc->base_addr[SPI0_AREA] + soc->base_offs[SPI0_AREA] + SPI0_FIFO, 4, SOC_SIM_FIFO, 0) != 0) {
+		return -1;
+	}
+
+	core_clock = broadcomSPI0CoreClock(soc, core_clock);
+
+	/*
+	 * The divider must be even, rounding it up keeps
+	 * the actual clock at or below the requested speed.
+	 */
+	cdiv = (uint32_t)((core_clock + (unsigned long)speed - 1) / (unsigned long)speed);
+	cdiv = (cdiv + 1) & ~1U;
+	if(cdiv < 2) {
+		cdiv = 2;
+	} else if(cdiv > 65534) {
+		/* 0 selects the slowest divider of 65536 */
+		cdiv = 0;
+	}
+
+	spi0[channel].cs = (uint32_t)channel;
+	if(mode & SPIMODE_CPHA) {
+		spi0[channel].cs |= SPI0_CS_CPHA;
+	}
+	if(mode & SPIMODE_CPOL) {
+		spi0[channel].cs |= SPI0_CS_CPOL;
+	}
+	if(mode & SPIMODE_CS_HIGH) {
+		spi0[channel].cs |= SPI0_CS_CSPOL;
+	}
+	spi0[channel].clk = cdiv;
+
+	/*
+	 * The kernel driver reprograms CS and CLK on each
+	 * of its own transfers, so restoring whatever it
+	 * left behind is enough to hand the block back.
+	 */
+	spi0[channel].saved_cs = soc_readl(broadcomSPI0Reg(soc, SPI0_CS)) & ~SPI0_CS_TA;
+	spi0[channel].saved_clk = soc_readl(broadcomSPI0Reg(soc, SPI0_CLK));
+	spi0[channel].active = 1;
+
+	return 0;
+}
+
+int broadcomSPI0DataRW(struct soc_t *soc, int channel, unsigned char *data, int len) {
+	uintptr_t cs = 0, fifo = 0;
+	long long start = 0;
+	unsigned int spins = 0;
+	uint32_t status = 0;
+	int tx = 0, rx = 0;
+
+	channel &= 1;
+
+	if(spi0[channel].active == 0 || soc->gpio[SPI0_AREA] == NULL) {
+		wiringXLog(LOG_ERR, "The %s %s direct SPI channel %d has not been setup", soc->brand, soc->chip, channel);
+		return -1;
+	}
+
+	cs = broadcomSPI0Reg(soc, SPI0_CS);
+	fifo = broadcomSPI0Reg(soc, SPI0_FIFO);
+
+	soc_writel(broadcomSPI0Reg(soc, SPI0_CLK), spi0[channel].clk);
+	soc_writel(cs, spi0[channel].cs | SPI0_CS_CLEAR_TX | SPI0_CS_CLEAR_RX);
+	soc_writel(cs, spi0[channel].cs | SPI0_CS_TA);
+
+	start = broadcomSPI0Now();
+	while(rx < len) {
+		status = soc_readl(cs);
+		while(tx < len && (status & SPI0_CS_TXD)) {
+			soc_writel(fifo, data[tx++]);
+			status = soc_readl(cs);
+		}
+		while(rx < len && (status & SPI0_CS_RXD)) {
+			data[rx++] = (unsigned char)soc_readl(fifo);
+			status = soc_readl(cs);
+		}
+		if((++spins & 0xFFF) == 0 && broadcomSPI0Now() - start > SPI0_TIMEOUT) {
+			break;
+		}
+	}
+	while(rx == len && (soc_readl(cs) & SPI0_CS_DONE) == 0) {
+		if((++spins & 0xFFF) == 0 && broadcomSPI0Now() - start > SPI0_TIMEOUT) {
+			break;
+		}
+	}
+
+	/* Dropping TA also clears DONE, so sample it first */
+	status = soc_readl(cs);
+	soc_writel(cs, spi0[channel].saved_cs | SPI0_CS_CLEAR_TX | SPI0_CS_CLEAR_RX);
+	soc_writel(broadcomSPI0Reg(soc, SPI0_CLK), spi0[channel].saved_clk);
+
+	if(rx < len || (status & SPI0_CS_DONE) == 0) {
+		wiringXLog(LOG_ERR, "The %s %s direct SPI channel %d timed out after %d of %d bytes", soc->brand, soc->chip, channel, rx, len);
+		return -1;
+	}
+
+	return 0;
+}
+
+int broadcomSPI0Release(struct soc_t *soc, int channel) {
+	channel &= 1;
+
+	if(spi0[channel].active == 0) {
+		return 0;
+	}
+	if(soc->gpio[SPI0_AREA] != NULL) {
+		soc_writel(broadcomSPI0Reg(soc, SPI0_CS), spi0[channel].saved_cs);
+		soc_writel(broadcomSPI0Reg(soc, SPI0_CLK), spi0[channel].saved_clk);
+	}
+	spi0[channel].active = 0;
+
+	if(spi0[channel ^ 1].active == 0 && soc->gpio[SPI0_AREA] != NULL) {
+		soc_munmap(soc, soc->gpio[SPI0_AREA]);
+		soc->gpio[SPI0_AREA] = NULL;
+	}
+
+	return 0;
+}
+
+int broadcomSPI0GC(struct soc_t *soc) {
+	broadcomSPI0Release(soc, 0);
+	broadcomSPI0Release(soc, 1);
+	return 0;
+}
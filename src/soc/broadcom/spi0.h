@@ -0,0 +1,31 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __WIRINGX_BROADCOM_SPI0_H_
+#define __WIRINGX_BROADCOM_SPI0_H_
+
+#include "../soc.h"
+#include "../../wiringx.h"
+
+/*
+ * The SPI0 block sits 0x4000 above the
+ * GPIO block on all Broadcom SoCs.
+ */
+#define BROADCOM_SPI0_OFFSET	0x4000
+
+/*
+ * core_clock is the platform default, only used
+ * when neither the kernel nor the firmware report
+ * the core clock the SPI0 divider is taken from.
+ */
+int broadcomSPI0Setup(struct soc_t *soc, int channel, int speed, unsigned int mode, unsigned long core_clock);
+int broadcomSPI0DataRW(struct soc_t *soc, int channel, unsigned char *data, int len);
+int broadcomSPI0Release(struct soc_t *soc, int channel);
+int broadcomSPI0GC(struct soc_t *soc);
+
+#endif
@@ -254,12 +254,12 @@ static struct layout_t {
 };
 
 static int nxpIMX6DQRMSetup(void) {
-	if((nxpIMX6DQRM->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(nxpIMX6DQRM) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((nxpIMX6DQRM->gpio[0] = (unsigned char *)mmap(0, nxpIMX6DQRM->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, nxpIMX6DQRM->fd, nxpIMX6DQRM->base_addr[0])) == NULL) {
+	if((nxpIMX6DQRM->gpio[0] = soc_mmap(nxpIMX6DQRM, nxpIMX6DQRM->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", nxpIMX6DQRM->brand, nxpIMX6DQRM->chip);
 		return -1;
 	}
@@ -453,7 +453,7 @@ static int nxpIMX6DQRMGC(void) {
 		}
 	}
 	if(nxpIMX6DQRM->gpio[0] != NULL) {
-		munmap(nxpIMX6DQRM->gpio[0], nxpIMX6DQRM->page_size);
+		soc_munmap(nxpIMX6DQRM, nxpIMX6DQRM->gpio[0]);
 	}
 	return 0;
 }
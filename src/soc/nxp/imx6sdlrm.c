@@ -254,12 +254,12 @@ static struct layout_t {
 };
 
 static int nxpIMX6SDLRMSetup(void) {
-	if((nxpIMX6SDLRM->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(nxpIMX6SDLRM) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 
-	if((nxpIMX6SDLRM->gpio[0] = (unsigned char *)mmap(0, nxpIMX6SDLRM->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, nxpIMX6SDLRM->fd, nxpIMX6SDLRM->base_addr[0])) == NULL) {
+	if((nxpIMX6SDLRM->gpio[0] = soc_mmap(nxpIMX6SDLRM, nxpIMX6SDLRM->base_addr[0])) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", nxpIMX6SDLRM->brand, nxpIMX6SDLRM->chip);
 		return -1;
 	}
@@ -453,7 +453,7 @@ static int nxpIMX6SDLRMGC(void) {
 		}
 	}
 	if(nxpIMX6SDLRM->gpio[0] != NULL) {
-		munmap(nxpIMX6SDLRM->gpio[0], nxpIMX6SDLRM->page_size);
+		soc_munmap(nxpIMX6SDLRM, nxpIMX6SDLRM->gpio[0]);
 	}
 	return 0;
 }
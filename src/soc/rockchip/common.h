@@ -61,9 +61,9 @@ struct layout_t {
 // Set lower bit to 0 and higher bit (write mask) to 1
 
 #define REGISTER_CLEAR_BITS(addr, bit, size) \
-	(*addr = *addr & ~(~(-1 << size) << bit) | (~(-1 << size) << bit << REGISTER_WRITE_MASK))
+	(soc_writel((uintptr_t)(addr), (soc_readl((uintptr_t)(addr)) & ~(~(-1 << size) << bit)) | (~(-1 << size) << bit << REGISTER_WRITE_MASK)))
 #define REGISTER_SET_HIGH(addr, bit, clear_bit_num) \
-	(*addr = *addr | (clear_bit_num << bit) | (clear_bit_num << bit << REGISTER_WRITE_MASK))
+	(soc_writel((uintptr_t)(addr), soc_readl((uintptr_t)(addr)) | (clear_bit_num << bit) | (clear_bit_num << bit << REGISTER_WRITE_MASK)))
 #define REGISTER_GET_BITS(addr, bit, size) \
 	((*addr & ~(-1 << size) << bit) >> (bit - size))
 
@@ -79,6 +79,6 @@ int rockchipSelectableFd(struct soc_t *soc, int i);
 
 #define rockchipGetPinLayout(soc, i) (rockchipGetLayout(soc, i, soc->map))
 #define rockchipGetIrqLayout(soc, i) (rockchipGetLayout(soc, i, soc->irq))
-#define rockchip_mmap(soc, offset) (mmap(0, soc->page_size, PROT_READ | PROT_WRITE, MAP_SHARED, soc->fd, offset))
+#define rockchip_mmap(soc, offset) (soc_mmap(soc, offset))
 
 #endif
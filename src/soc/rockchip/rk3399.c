@@ -217,7 +217,7 @@ static struct layout_t layout[] = {
 static int rk3399Setup(void) {
 	int i = 0;
 
-	if((rk3399->fd = open("/dev/mem", O_RDWR | O_SYNC)) < 0) {
+	if(soc_mem_open(rk3399) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
@@ -244,6 +244,12 @@ static int rk3399Setup(void) {
 		return -1;
 	}
 
+	/* The CRU and GRF registers take a write mask, the GPIO ones do not */
+	soc_sim_rule(rk3399, CRU_REGISTER_PHYSICAL_ADDRESS, rk3399->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3399, PMUCRU_REGISTER_PHYSICAL_ADDRESS, rk3399->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3399, PMUGRF_REGISTER_PHYSICAL_ADDRESS, rk3399->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3399, GRF_REGISTER_PHYSICAL_ADDRESS, rk3399->page_size, SOC_SIM_MASKED, 0);
+
 	return 0;
 }
 
@@ -311,7 +317,7 @@ static int rk3399PinMode(int i, enum pinmode_t mode) {
 		wiringXLog(LOG_ERR, "pin->iomux_num out of range %i, expect 0~2", i);
 	}
 	// set to low to enable the clock for GPIO bank
-	*cru_reg = REGISTER_CLEAR_BITS(cru_reg, pin->cru.bit, 1);
+	REGISTER_CLEAR_BITS(cru_reg, pin->cru.bit, 1);
 
 	if(pin->iomux_num == 0) {
 		grf_reg = (volatile unsigned int *)(pmugrf_register_virtual_address + pin->grf.offset);
@@ -320,7 +326,7 @@ static int rk3399PinMode(int i, enum pinmode_t mode) {
 	} else {
 		wiringXLog(LOG_ERR, "pin->iomux_num out of range %i, expect 0~2", i);
 	}
-	*grf_reg = REGISTER_CLEAR_BITS(grf_reg, pin->grf.bit, 2);
+	REGISTER_CLEAR_BITS(grf_reg, pin->grf.bit, 2);
 
 	dir_reg = (volatile unsigned int *)(rk3399->gpio[pin->bank] + pin->direction.offset);
 	if(mode == PINMODE_INPUT) {
@@ -349,24 +355,24 @@ static int rk3399GC(void) {
 	rockchipGC(rk3399);
 
 	if(cru_register_virtual_address != NULL) {
-		munmap(cru_register_virtual_address, rk3399->page_size);
+		soc_munmap(rk3399, cru_register_virtual_address);
 		cru_register_virtual_address = NULL;
 	}
 	if(pmucru_register_virtual_address != NULL) {
-		munmap(pmucru_register_virtual_address, rk3399->page_size);
+		soc_munmap(rk3399, pmucru_register_virtual_address);
 		pmucru_register_virtual_address = NULL;
 	}
 	if(pmugrf_register_virtual_address != NULL) {
-		munmap(pmugrf_register_virtual_address, rk3399->page_size);
+		soc_munmap(rk3399, pmugrf_register_virtual_address);
 		pmugrf_register_virtual_address = NULL;
 	}
 	if(grf_register_virtual_address != NULL) {
-		munmap(grf_register_virtual_address, rk3399->page_size);
+		soc_munmap(rk3399, grf_register_virtual_address);
 		grf_register_virtual_address = NULL;
 	}
 	for(int i = 0; i < GPIO_BANK_COUNT; i++) {
 		if(rk3399->gpio[i] != NULL) {
-			munmap(rk3399->gpio[i], rk3399->page_size);
+			soc_munmap(rk3399, rk3399->gpio[i]);
 			rk3399->gpio[i] = NULL;
 		}
 	}
@@ -239,7 +239,7 @@ static struct layout_t layout[] = {
 };
 
 static int rk3588Setup(void) {
-	if((rk3588->fd = open("/dev/mem", O_RDWR | O_SYNC)) < 0) {
+	if(soc_mem_open(rk3588) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
@@ -267,6 +267,15 @@ static int rk3588Setup(void) {
 		return -1;
 	}
 
+	/* All GPIO, CRU and IOC registers take a write mask */
+	for(int i = 0; i < GPIO_BANK_COUNT; i++) {
+		soc_sim_rule(rk3588, rk3588->base_addr[i], rk3588->page_size, SOC_SIM_MASKED, 0);
+	}
+	soc_sim_rule(rk3588, CRU_NS_REGISTER_PHYSICAL_ADDRESS, rk3588->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3588, PMU1_IOC_REGISTER_PHYSICAL_ADDRESS, rk3588->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3588, PMU2_IOC_REGISTER_PHYSICAL_ADDRESS, rk3588->page_size, SOC_SIM_MASKED, 0);
+	soc_sim_rule(rk3588, BUS_IOC_REGISTER_PHYSICAL_ADDRESS, rk3588->page_size, SOC_SIM_MASKED, 0);
+
 	return 0;
 }
 
@@ -369,24 +378,24 @@ static int rk3588GC(void) {
 	rockchipGC(rk3588);
 
 	if(cru_ns_register_virtual_address != NULL) {
-		munmap(cru_ns_register_virtual_address, rk3588->page_size);
+		soc_munmap(rk3588, cru_ns_register_virtual_address);
 		cru_ns_register_virtual_address = NULL;
 	}
 	if(pmu1_ioc_register_virtual_address != NULL) {
-		munmap(pmu1_ioc_register_virtual_address, rk3588->page_size);
+		soc_munmap(rk3588, pmu1_ioc_register_virtual_address);
 		pmu1_ioc_register_virtual_address = NULL;
 	}
 	if(pmu2_ioc_register_virtual_address != NULL) {
-		munmap(pmu2_ioc_register_virtual_address, rk3588->page_size);
+		soc_munmap(rk3588, pmu2_ioc_register_virtual_address);
 		pmu2_ioc_register_virtual_address = NULL;
 	}
 	if(bus_ioc_register_virtual_address != NULL) {
-		munmap(bus_ioc_register_virtual_address, rk3588->page_size);
+		soc_munmap(rk3588, bus_ioc_register_virtual_address);
 		bus_ioc_register_virtual_address = NULL;
 	}
 	for(int i = 0; i < GPIO_BANK_COUNT; i++) {
 		if(rk3588->gpio[i] != NULL) {
-			munmap(rk3588->gpio[i], rk3588->page_size);
+			soc_munmap(rk3588, rk3588->gpio[i]);
 			rk3588->gpio[i] = NULL;
 		}
 	}
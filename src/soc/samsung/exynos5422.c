@@ -280,7 +280,7 @@ static struct layout_t {
 static int exynos5422Setup(void) {
 	int i = 0;
 
-	if((exynos5422->fd = open("/dev/mem", O_RDWR | O_SYNC )) < 0) {
+	if(soc_mem_open(exynos5422) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
@@ -290,7 +290,7 @@ static int exynos5422Setup(void) {
 	 * -> 0: 0x13400000, 1: 0x13410000, 2: 0x14000000, 3: 0x14010000, 4: 0x03860000
 	 */
 	for(i = 0; i < 5; ++i) {
-		if((exynos5422->gpio[i] = mmap(0, exynos5422->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, exynos5422->fd, exynos5422->base_addr[i])) == MAP_FAILED) {
+		if((exynos5422->gpio[i] = soc_mmap(exynos5422, exynos5422->base_addr[i])) == NULL) {
 			wiringXLog(LOG_ERR, "wiringX failed to map the %s %s GPIO memory address", exynos5422->brand, exynos5422->chip);
 			return -1;
 		}
@@ -483,7 +483,7 @@ static int exynos5422GC(void) {
 		}
 	}
 	if(exynos5422->gpio[0] != NULL) {
-		munmap(exynos5422->gpio[0], exynos5422->page_size);
+		soc_munmap(exynos5422, exynos5422->gpio[0]);
 	}
 	return 0;
 }
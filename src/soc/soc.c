@@ -6,6 +6,7 @@
   file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
@@ -16,12 +17,64 @@
 #include <stdlib.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 
 #include "../wiringx.h"
 #include "soc.h"
 
+#define SOC_SIM_MAX_REGIONS	64
+#define SOC_SIM_MAX_RULES		64
+#define SOC_SIM_MAX_FIFOS		4
+#define SOC_SIM_FIFO_SIZE		64
+
+typedef struct soc_region_t {
+	uintptr_t addr;
+	off_t offset;
+	size_t size;
+	unsigned char *virt;
+	int users;
+} soc_region_t;
+
+typedef struct soc_rule_t {
+	uintptr_t addr;
+	size_t size;
+	enum soc_sim_rule_t rule;
+	uintptr_t target;
+} soc_rule_t;
+
+typedef struct soc_fifo_t {
+	uintptr_t addr;
+	/* Written by the driver */
+	uint32_t tx[SOC_SIM_FIFO_SIZE];
+	int ntx;
+	/* Read by the driver */
+	uint32_t rx[SOC_SIM_FIFO_SIZE];
+	int nrx;
+} soc_fifo_t;
+
 static struct soc_t *socs = NULL;
 
+static int soc_devmem_open(struct soc_t *);
+static void *soc_devmem_map(struct soc_t *, uintptr_t);
+static void soc_devmem_unmap(struct soc_t *, void *);
+static int soc_sim_open(struct soc_t *);
+static void *soc_sim_map(struct soc_t *, uintptr_t);
+static void soc_sim_unmap(struct soc_t *, void *);
+
+struct soc_mem_t soc_mem_devmem = { "devmem", soc_devmem_open, soc_devmem_map, soc_devmem_unmap };
+struct soc_mem_t soc_mem_sim = { "simulated", soc_sim_open, soc_sim_map, soc_sim_unmap };
+
+static struct soc_mem_t *soc_mem = &soc_mem_devmem;
+
+static int soc_sim_fd = -1;
+static off_t soc_sim_size = 0;
+static struct soc_region_t soc_regions[SOC_SIM_MAX_REGIONS];
+static int soc_nrregions = 0;
+static struct soc_rule_t soc_rules[SOC_SIM_MAX_RULES];
+static int soc_nrrules = 0;
+static struct soc_fifo_t soc_fifos[SOC_SIM_MAX_FIFOS];
+static int soc_nrfifos = 0;
+
 void soc_register(struct soc_t **soc, char *brand, char *type) {
 	int i = 0;
 
@@ -59,6 +112,10 @@ void soc_register(struct soc_t **soc, char *brand, char *type) {
 	(*soc)->selectableFd = NULL;
 	(*soc)->gc = NULL;
 
+	(*soc)->spiSetup = NULL;
+	(*soc)->spiDataRW = NULL;
+	(*soc)->spiRelease = NULL;
+
 	for(i = 0; i < MAX_REG_AREA; ++i) {
 		(*soc)->gpio[i] = NULL;
 		(*soc)->base_addr[i] = 0;
@@ -69,11 +126,23 @@ void soc_register(struct soc_t **soc, char *brand, char *type) {
 	socs = *soc;
 }
 
+static int soc_sim_write(uintptr_t, uint32_t);
+static int soc_sim_read(uintptr_t, uint32_t *);
+
 void soc_writel(uintptr_t addr, uint32_t val) {
+	/* Only the simulated memory ever has rules */
+	if(soc_nrrules > 0 && soc_sim_write(addr, val) == 0) {
+		return;
+	}
 	*((volatile uint32_t *)(addr)) = val;
 }
 
 uint32_t soc_readl(uintptr_t addr) {
+	uint32_t val = 0;
+
+	if(soc_nrfifos > 0 && soc_sim_read(addr, &val) == 0) {
+		return val;
+	}
 	return *((volatile uint32_t *)(addr));
 }
 
@@ -267,10 +336,292 @@ struct soc_t *soc_get(char *brand, char *chip) {
 
 int soc_gc(void) {
 	struct soc_t *tmp = NULL;
+	int i = 0;
+
 	while(socs) {
 		tmp = socs;
 		socs = socs->next;
 		free(tmp);
 	}
+	/* Not every driver unmaps all of its areas */
+	for(i=0;i<soc_nrregions;i++) {
+		if(soc_regions[i].virt != NULL) {
+			munmap(soc_regions[i].virt, soc_regions[i].size);
+		}
+	}
+	if(soc_sim_fd >= 0) {
+		close(soc_sim_fd);
+		soc_sim_fd = -1;
+	}
+	soc_sim_size = 0;
+	soc_nrregions = 0;
+	soc_nrrules = 0;
+	soc_nrfifos = 0;
+	/* wiringXSimulate only lasts until the next wiringXGC */
+	soc_mem = &soc_mem_devmem;
+	return 0;
+}
+
+/* Selects the memory backend for the next SoC setup, NULL restores /dev/mem */
+void soc_mem_set(struct soc_mem_t *mem) {
+	soc_mem = (mem == NULL) ? &soc_mem_devmem : mem;
+}
+
+struct soc_mem_t *soc_mem_get(void) {
+	return soc_mem;
+}
+
+int soc_mem_open(struct soc_t *soc) {
+	return soc_mem->open(soc);
+}
+
+/* Maps page_size bytes of the register area at addr, NULL on failure */
+void *soc_mmap(struct soc_t *soc, uintptr_t addr) {
+	return soc_mem->map(soc, addr);
+}
+
+void soc_munmap(struct soc_t *soc, void *virt) {
+	soc_mem->unmap(soc, virt);
+}
+
+static int soc_devmem_open(struct soc_t *soc) {
+	if((soc->fd = open("/dev/mem", O_RDWR | O_SYNC)) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+static void *soc_devmem_map(struct soc_t *soc, uintptr_t addr) {
+	void *virt = mmap(0, soc->page_size, PROT_READ|PROT_WRITE, MAP_SHARED, soc->fd, (off_t)addr);
+
+	return (virt == MAP_FAILED) ? NULL : virt;
+}
+
+static void soc_devmem_unmap(struct soc_t *soc, void *virt) {
+	munmap(virt, soc->page_size);
+}
+
+/*
+ * All simulated areas live in one memory file. An
+ * area that is mapped twice hands out the same
+ * mapping, so both users see the same registers.
+ */
+static int soc_sim_open(struct soc_t *soc) {
+	if(soc_sim_fd < 0 && (soc_sim_fd = memfd_create("wiringx-sim", MFD_CLOEXEC)) < 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to create the simulated %s %s memory (%s)", soc->brand, soc->chip, strerror(errno));
+		return -1;
+	}
+	soc->fd = soc_sim_fd;
 	return 0;
 }
+
+static void *soc_sim_map(struct soc_t *soc, uintptr_t addr) {
+	struct soc_region_t *region = NULL;
+	void *virt = NULL;
+	int i = 0;
+
+	for(i=0;i<soc_nrregions;i++) {
+		if(soc_regions[i].addr == addr && soc_regions[i].size >= soc->page_size) {
+			region = &soc_regions[i];
+			break;
+		}
+	}
+	if(region == NULL) {
+		if(soc_nrregions == SOC_SIM_MAX_REGIONS) {
+			wiringXLog(LOG_ERR, "wiringX can simulate at most %d register areas", SOC_SIM_MAX_REGIONS);
+			return NULL;
+		}
+		if(ftruncate(soc_sim_fd, soc_sim_size + (off_t)soc->page_size) < 0) {
+			return NULL;
+		}
+		region = &soc_regions[soc_nrregions++];
+		region->addr = addr;
+		region->offset = soc_sim_size;
+		region->size = soc->page_size;
+		region->virt = NULL;
+		region->users = 0;
+		soc_sim_size += (off_t)soc->page_size;
+	}
+
+	if(region->virt == NULL) {
+		if((virt = mmap(0, region->size, PROT_READ|PROT_WRITE, MAP_SHARED, soc_sim_fd, region->offset)) == MAP_FAILED) {
+			return NULL;
+		}
+		region->virt = virt;
+	}
+	region->users++;
+
+	return region->virt;
+}
+
+static void soc_sim_unmap(struct soc_t *soc, void *virt) {
+	int i = 0;
+
+	for(i=0;i<soc_nrregions;i++) {
+		if(soc_regions[i].virt == virt) {
+			if(--soc_regions[i].users == 0) {
+				munmap(virt, soc_regions[i].size);
+				soc_regions[i].virt = NULL;
+			}
+			return;
+		}
+	}
+}
+
+static volatile uint32_t *soc_sim_virt(uintptr_t addr) {
+	int i = 0;
+
+	for(i=0;i<soc_nrregions;i++) {
+		if(soc_regions[i].virt != NULL && addr >= soc_regions[i].addr && addr + 4 <= soc_regions[i].addr + soc_regions[i].size) {
+			return (volatile uint32_t *)(soc_regions[i].virt + (addr - soc_regions[i].addr));
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Adds the semantics of size bytes of registers at
+ * the physical address addr. For SOC_SIM_SET and
+ * SOC_SIM_CLEAR, target is the physical address of
+ * the register the first one acts on. Without the
+ * simulated memory this does nothing, so drivers can
+ * describe their registers unconditionally, and
+ * describing the same rule again is ignored.
+ */
+int soc_sim_rule(struct soc_t *soc, uintptr_t addr, size_t size, enum soc_sim_rule_t rule, uintptr_t target) {
+	int i = 0;
+
+	if(soc_mem != &soc_mem_sim) {
+		return 0;
+	}
+	for(i=0;i<soc_nrrules;i++) {
+		if(soc_rules[i].addr == addr && soc_rules[i].size == size && soc_rules[i].rule == rule &&
+		   (rule == SOC_SIM_FIFO || soc_rules[i].target == target)) {
+			return 0;
+		}
+	}
+	if(soc_nrrules == SOC_SIM_MAX_RULES || (rule == SOC_SIM_FIFO && soc_nrfifos == SOC_SIM_MAX_FIFOS)) {
+		wiringXLog(LOG_ERR, "The simulated %s %s has too many register rules", soc->brand, soc->chip);
+		return -1;
+	}
+	if(rule == SOC_SIM_FIFO) {
+		memset(&soc_fifos[soc_nrfifos], 0, sizeof(struct soc_fifo_t));
+		soc_fifos[soc_nrfifos].addr = addr;
+		target = (uintptr_t)soc_nrfifos++;
+	}
+
+	soc_rules[soc_nrrules].addr = addr;
+	soc_rules[soc_nrrules].size = size;
+	soc_rules[soc_nrrules].rule = rule;
+	soc_rules[soc_nrrules].target = target;
+	soc_nrrules++;
+
+	return 0;
+}
+
+/* Returns 0 when a rule handled the write */
+/* Physical address of a mapped simulated register, 0 when unmapped */
+static uintptr_t soc_sim_phys(uintptr_t addr) {
+	int i = 0;
+
+	for(i=0;i<soc_nrregions;i++) {
+		if(soc_regions[i].virt != NULL && addr >= (uintptr_t)soc_regions[i].virt && addr < (uintptr_t)soc_regions[i].virt + soc_regions[i].size) {
+			return soc_regions[i].addr + (addr - (uintptr_t)soc_regions[i].virt);
+		}
+	}
+	return 0;
+}
+
+static struct soc_fifo_t *soc_sim_fifo(uintptr_t phys) {
+	int i = 0;
+
+	for(i=0;i<soc_nrfifos;i++) {
+		if(soc_fifos[i].addr == phys) {
+			return &soc_fifos[i];
+		}
+	}
+	return NULL;
+}
+
+/* Queues a word for the driver to read from the FIFO at phys */
+int soc_sim_fifo_push(uintptr_t phys, uint32_t val) {
+	struct soc_fifo_t *fifo = soc_sim_fifo(phys);
+
+	if(fifo == NULL || fifo->nrx == SOC_SIM_FIFO_SIZE) {
+		return -1;
+	}
+	fifo->rx[fifo->nrx++] = val;
+	return 0;
+}
+
+/* Takes the oldest word the driver wrote to the FIFO at phys */
+int soc_sim_fifo_pop(uintptr_t phys, uint32_t *val) {
+	struct soc_fifo_t *fifo = soc_sim_fifo(phys);
+
+	if(fifo == NULL || fifo->ntx == 0) {
+		return -1;
+	}
+	*val = fifo->tx[0];
+	memmove(&fifo->tx[0], &fifo->tx[1], sizeof(uint32_t)*(size_t)(--fifo->ntx));
+	return 0;
+}
+
+/* Returns 0 when a FIFO handled the read, an empty one reads as 0 */
+static int soc_sim_read(uintptr_t addr, uint32_t *val) {
+	struct soc_fifo_t *fifo = NULL;
+
+	if((fifo = soc_sim_fifo(soc_sim_phys(addr))) == NULL) {
+		return -1;
+	}
+	*val = 0;
+	if(fifo->nrx > 0) {
+		*val = fifo->rx[0];
+		memmove(&fifo->rx[0], &fifo->rx[1], sizeof(uint32_t)*(size_t)(--fifo->nrx));
+	}
+	return 0;
+}
+
+static int soc_sim_write(uintptr_t addr, uint32_t val) {
+	struct soc_fifo_t *fifo = NULL;
+	volatile uint32_t *reg = NULL;
+	uintptr_t phys = 0;
+	uint32_t mask = 0;
+	int i = 0;
+
+	if((phys = soc_sim_phys(addr)) == 0) {
+		return -1;
+	}
+
+	for(i=0;i<soc_nrrules;i++) {
+		if(phys < soc_rules[i].addr || phys >= soc_rules[i].addr + soc_rules[i].size) {
+			continue;
+		}
+		switch(soc_rules[i].rule) {
+			case SOC_SIM_SET:
+			case SOC_SIM_CLEAR:
+				if((reg = soc_sim_virt(soc_rules[i].target + (phys - soc_rules[i].addr))) == NULL) {
+					return -1;
+				}
+				if(soc_rules[i].rule == SOC_SIM_SET) {
+					*reg |= val;
+				} else {
+					*reg &= ~val;
+				}
+			return 0;
+			case SOC_SIM_MASKED:
+				reg = (volatile uint32_t *)addr;
+				mask = val >> 16;
+				/* The mask half always reads back as zero */
+				*reg = ((*reg & ~mask) | (val & mask)) & 0xFFFF;
+			return 0;
+			case SOC_SIM_FIFO:
+				fifo = &soc_fifos[soc_rules[i].target];
+				if(fifo->ntx < SOC_SIM_FIFO_SIZE) {
+					fifo->tx[fifo->ntx++] = val;
+				}
+			return 0;
+		}
+	}
+
+	return -1;
+}
@@ -54,15 +54,56 @@ typedef struct soc_t {
 	int (*selectableFd)(int);
 	int (*gc)(void);
 
+	int (*spiSetup)(int, int, unsigned int);
+	int (*spiDataRW)(int, unsigned char *, int);
+	int (*spiRelease)(int);
+
 	struct soc_t *next;
 } soc_t;
 
+/*
+ * How the register areas of a SoC get mapped. The
+ * default goes through /dev/mem, the simulated one
+ * backs every area with shared memory so the drivers
+ * run on machines without the hardware.
+ */
+typedef struct soc_mem_t {
+	char *name;
+	int (*open)(struct soc_t *);
+	void *(*map)(struct soc_t *, uintptr_t);
+	void (*unmap)(struct soc_t *, void *);
+} soc_mem_t;
+
+/* Register semantics the simulated memory can model */
+enum soc_sim_rule_t {
+	/* Writing 1 bits sets them in the target register */
+	SOC_SIM_SET = 1,
+	/* Writing 1 bits clears them in the target register */
+	SOC_SIM_CLEAR = 2,
+	/* The upper 16 bits select which lower 16 bits are written */
+	SOC_SIM_MASKED = 3,
+	/* Writes queue for soc_sim_fifo_pop, reads take from soc_sim_fifo_push */
+	SOC_SIM_FIFO = 4
+};
+
+extern struct soc_mem_t soc_mem_devmem;
+extern struct soc_mem_t soc_mem_sim;
+
 void soc_register(struct soc_t **, char *, char *);
 struct soc_t *soc_get(char *, char *);
 void soc_writel(uintptr_t, uint32_t);
 uint32_t soc_readl(uintptr_t);
 int soc_gc(void);
 
+void soc_mem_set(struct soc_mem_t *);
+struct soc_mem_t *soc_mem_get(void);
+int soc_mem_open(struct soc_t *);
+void *soc_mmap(struct soc_t *, uintptr_t);
+void soc_munmap(struct soc_t *, void *);
+int soc_sim_rule(struct soc_t *, uintptr_t, size_t, enum soc_sim_rule_t, uintptr_t);
+int soc_sim_fifo_push(uintptr_t, uint32_t);
+int soc_sim_fifo_pop(uintptr_t, uint32_t *);
+
 int soc_sysfs_check_gpio(struct soc_t *, char *);
 int soc_sysfs_gpio_export(struct soc_t *, char *, int);
 int soc_sysfs_gpio_unexport(struct soc_t *, char *, int);
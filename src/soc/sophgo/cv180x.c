@@ -202,17 +202,17 @@ static struct layout_t {
 static int cv180xSetup(void) {
 	int i = 0;
 
-	if((cv180x->fd = open("/dev/mem", O_RDWR | O_SYNC)) < 0) {
+	if(soc_mem_open(cv180x) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to open /dev/mem for raw memory access");
 		return -1;
 	}
 	for(i = 0; i < CV180X_GPIO_GROUP_COUNT; i++) {
-		if((cv180x->gpio[i] = (unsigned char *)mmap(0, cv180x->page_size, PROT_READ | PROT_WRITE, MAP_SHARED, cv180x->fd, cv180x->base_addr[i])) == NULL) {
+		if((cv180x->gpio[i] = soc_mmap(cv180x, cv180x->base_addr[i])) == NULL) {
 			wiringXLog(LOG_ERR, "wiringX failed to map The %s %s GPIO memory address", cv180x->brand, cv180x->chip);
 			return -1;
 		}
 	}
-	if((pinmux_register_virtual_address = (unsigned char *)mmap(0, cv180x->page_size, PROT_READ | PROT_WRITE, MAP_SHARED, cv180x->fd, PINMUX_BASE)) == NULL) {
+	if((pinmux_register_virtual_address = soc_mmap(cv180x, PINMUX_BASE)) == NULL) {
 		wiringXLog(LOG_ERR, "wiringX failed to map The %s %s CRU memory address", cv180x->brand, cv180x->chip);
 		return -1;
 	}
@@ -422,12 +422,12 @@ static int cv180xGC(void) {
 	}
 
 	if(pinmux_register_virtual_address != NULL) {
-		munmap(pinmux_register_virtual_address, cv180x->page_size);
+		soc_munmap(cv180x, pinmux_register_virtual_address);
 		pinmux_register_virtual_address = NULL;
 	}
 	for(i = 0; i < CV180X_GPIO_GROUP_COUNT; i++) {
 		if(cv180x->gpio[i] != NULL) {
-			munmap(cv180x->gpio[i], cv180x->page_size);
+			soc_munmap(cv180x, cv180x->gpio[i]);
 			cv180x->gpio[i] = NULL;
 		}
 	}
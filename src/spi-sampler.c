@@ -0,0 +1,254 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "wiringx.h"
+#include "ring.h"
+#include "spi-sampler.h"
+
+typedef struct wiringXSPISampler_t {
+	struct wiringXSPISamplerConfig_t config;
+	struct wiringXSPITransfer_t xfers[SPI_SAMPLER_MAX_INPUTS];
+	unsigned char tx[SPI_SAMPLER_MAX_INPUTS*SPI_SAMPLER_MAX_FRAME];
+	unsigned char rx[SPI_SAMPLER_MAX_INPUTS*SPI_SAMPLER_MAX_FRAME];
+
+	struct ring_t ring;
+	pthread_t thread;
+	int running;
+
+	uint64_t period;
+	uint64_t start;
+	uint64_t last;
+
+	struct wiringXSPISamplerStats_t stats;
+} wiringXSPISampler_t;
+
+static uint64_t spi_sampler_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void spi_sampler_sleep_until(uint64_t deadline) {
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+	ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+/*
+ * MCP3204 / MCP3208 single ended conversion:
+ * start bit, SGL/DIFF and D2 in the first byte,
+ * D1 and D0 in the top of the second byte.
+ */
+static void spi_sampler_mcp320x_encode(int input, unsigned char *frame, int len) {
+	memset(frame, 0, len);
+	frame[0] = 0x06 | ((input >> 2) & 0x01);
+	frame[1] = (input & 0x03) << 6;
+}
+
+static int spi_sampler_mcp320x_decode(int input, const unsigned char *frame, int len) {
+	return ((frame[1] & 0x0F) << 8) | frame[2];
+}
+
+static void *spi_sampler_thread(void *param) {
+	struct wiringXSPISampler_t *sampler = param;
+	struct wiringXSPISamplerConfig_t *config = &sampler->config;
+	struct wiringXSPISample_t sample;
+	uint64_t deadline = 0, now = 0, late = 0, skip = 0;
+	uint32_t seq = 0;
+	int i = 0;
+
+	deadline = spi_sampler_now() + sampler->period;
+
+	while(__atomic_load_n(&sampler->running, __ATOMIC_ACQUIRE) == 1) {
+		spi_sampler_sleep_until(deadline);
+
+		now = spi_sampler_now();
+		late = (now > deadline) ? now - deadline : 0;
+		if(late > sampler->stats.max_lateness_ns) {
+			__atomic_store_n(&sampler->stats.max_lateness_ns, late, __ATOMIC_RELAXED);
+		}
+
+		/*
+		 * Keep the original grid instead of drifting
+		 * when one or more periods were slept through.
+		 */
+		if(late >= sampler->period) {
+			skip = late / sampler->period;
+			deadline += skip * sampler->period;
+			__atomic_add_fetch(&sampler->stats.missed, skip, __ATOMIC_RELAXED);
+		}
+
+		memset(&sample, 0, sizeof(sample));
+		sample.timestamp = now;
+		sample.seq = seq++;
+
+		if(wiringXSPITransfer(config->channel, sampler->xfers, config->ninputs) < 0) {
+			__atomic_add_fetch(&sampler->stats.errors, 1, __ATOMIC_RELAXED);
+		} else {
+			for(i=0;i<config->ninputs;i++) {
+				sample.value[i] = (uint16_t)config->decode(config->inputs[i], &sampler->rx[i*config->frame_len], config->frame_len);
+			}
+			if(ring_push(&sampler->ring, &sample, 1) == 0) {
+				__atomic_add_fetch(&sampler->stats.dropped, 1, __ATOMIC_RELAXED);
+			}
+			if(sampler->start == 0) {
+				__atomic_store_n(&sampler->start, now, __ATOMIC_RELAXED);
+			}
+			__atomic_store_n(&sampler->last, now, __ATOMIC_RELAXED);
+			__atomic_add_fetch(&sampler->stats.scans, 1, __ATOMIC_RELAXED);
+		}
+
+		deadline += sampler->period;
+	}
+
+	return NULL;
+}
+
+EXPORT struct wiringXSPISampler_t *wiringXSPISamplerStart(struct wiringXSPISamplerConfig_t *config) {
+	struct wiringXSPISampler_t *sampler = NULL;
+	struct sched_param param;
+	pthread_attr_t attr;
+	int i = 0, ret = 0;
+
+	if(config->rate == 0) {
+		wiringXLog(LOG_ERR, "wiringX SPI sampler needs a rate above zero");
+		return NULL;
+	}
+	if(config->ninputs <= 0 || config->ninputs > SPI_SAMPLER_MAX_INPUTS) {
+		wiringXLog(LOG_ERR, "wiringX SPI sampler can handle 1 to %d inputs", SPI_SAMPLER_MAX_INPUTS);
+		return NULL;
+	}
+	if(config->frame_len <= 0 || config->frame_len > SPI_SAMPLER_MAX_FRAME) {
+		wiringXLog(LOG_ERR, "wiringX SPI sampler can handle frames of 1 to %d bytes", SPI_SAMPLER_MAX_FRAME);
+		return NULL;
+	}
+	if((config->encode == NULL || config->decode == NULL) && config->frame_len < 3) {
+		wiringXLog(LOG_ERR, "wiringX SPI sampler MCP320x frames need at least 3 bytes");
+		return NULL;
+	}
+
+	if((sampler = malloc(sizeof(struct wiringXSPISampler_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	memset(sampler, 0, sizeof(struct wiringXSPISampler_t));
+	memcpy(&sampler->config, config, sizeof(struct wiringXSPISamplerConfig_t));
+
+	config = &sampler->config;
+	if(config->encode == NULL || config->decode == NULL) {
+		config->encode = spi_sampler_mcp320x_encode;
+		config->decode = spi_sampler_mcp320x_decode;
+	}
+	if(config->ring_size == 0) {
+		config->ring_size = config->rate;
+	}
+
+	/*
+	 * The commands never change, so the whole
+	 * multi-segment message is prepared once and
+	 * every scan is a single SPI_IOC_MESSAGE.
+	 */
+	for(i=0;i<config->ninputs;i++) {
+		config->encode(config->inputs[i], &sampler->tx[i*config->frame_len], config->frame_len);
+		sampler->xfers[i].tx = &sampler->tx[i*config->frame_len];
+		sampler->xfers[i].rx = &sampler->rx[i*config->frame_len];
+		sampler->xfers[i].len = config->frame_len;
+		sampler->xfers[i].cs_change = (i < config->ninputs-1) ? 1 : 0;
+	}
+
+	ring_init(&sampler->ring, sizeof(struct wiringXSPISample_t), config->ring_size);
+	sampler->period = 1000000000ULL / config->rate;
+	sampler->running = 1;
+
+	pthread_attr_init(&attr);
+	if(config->priority > 0) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = config->priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+
+	if(pthread_create(&sampler->thread, &attr, spi_sampler_thread, sampler) != 0) {
+		if(config->priority > 0) {
+			wiringXLog(LOG_WARNING, "wiringX SPI sampler could not get realtime priority %d, running at default priority", config->priority);
+			pthread_attr_destroy(&attr);
+			pthread_attr_init(&attr);
+		}
+		if((ret = pthread_create(&sampler->thread, &attr, spi_sampler_thread, sampler)) != 0) {
+			wiringXLog(LOG_ERR, "wiringX failed to start the SPI sampler thread (%s)", strerror(ret));
+			pthread_attr_destroy(&attr);
+			ring_gc(&sampler->ring);
+			free(sampler);
+			return NULL;
+		}
+	}
+	pthread_attr_destroy(&attr);
+
+	return sampler;
+}
+
+EXPORT int wiringXSPISamplerRead(struct wiringXSPISampler_t *sampler, struct wiringXSPISample_t *samples, int max) {
+	if(sampler == NULL || max <= 0) {
+		return -1;
+	}
+	return (int)ring_pop(&sampler->ring, samples, (size_t)max);
+}
+
+EXPORT int wiringXSPISamplerStats(struct wiringXSPISampler_t *sampler, struct wiringXSPISamplerStats_t *stats) {
+	uint64_t start = 0, last = 0;
+
+	if(sampler == NULL) {
+		return -1;
+	}
+
+	stats->scans = __atomic_load_n(&sampler->stats.scans, __ATOMIC_RELAXED);
+	stats->missed = __atomic_load_n(&sampler->stats.missed, __ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&sampler->stats.dropped, __ATOMIC_RELAXED);
+	stats->errors = __atomic_load_n(&sampler->stats.errors, __ATOMIC_RELAXED);
+	stats->max_lateness_ns = __atomic_load_n(&sampler->stats.max_lateness_ns, __ATOMIC_RELAXED);
+
+	start = __atomic_load_n(&sampler->start, __ATOMIC_RELAXED);
+	last = __atomic_load_n(&sampler->last, __ATOMIC_RELAXED);
+	if(stats->scans > 1 && last > start) {
+		stats->rate = (double)(stats->scans-1) * 1e9 / (double)(last - start);
+	} else {
+		stats->rate = 0.0;
+	}
+
+	return 0;
+}
+
+EXPORT int wiringXSPISamplerStop(struct wiringXSPISampler_t *sampler) {
+	if(sampler == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&sampler->running, 0, __ATOMIC_RELEASE);
+	pthread_join(sampler->thread, NULL);
+
+	ring_gc(&sampler->ring);
+	free(sampler);
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_SPI_SAMPLER_H_
+#define _WIRINGX_SPI_SAMPLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wiringx.h"
+
+#define SPI_SAMPLER_MAX_INPUTS	16
+#define SPI_SAMPLER_MAX_FRAME	8
+
+typedef struct wiringXSPISamplerConfig_t {
+	/* SPI channel that has already been setup */
+	int channel;
+	/* Scans per second, one scan reads all inputs */
+	unsigned int rate;
+	int ninputs;
+	int inputs[SPI_SAMPLER_MAX_INPUTS];
+	/* Bytes clocked per conversion, 3 for a MCP3208 */
+	int frame_len;
+	/* Number of scans the ring can hold */
+	size_t ring_size;
+	/* SCHED_FIFO priority of the sampler thread, 0 keeps the default */
+	int priority;
+	/* Leaving these NULL selects the MCP320x command format */
+	void (*encode)(int input, unsigned char *frame, int len);
+	int (*decode)(int input, const unsigned char *frame, int len);
+} wiringXSPISamplerConfig_t;
+
+typedef struct wiringXSPISample_t {
+	/* CLOCK_MONOTONIC in nanoseconds at the start of the scan */
+	uint64_t timestamp;
+	uint32_t seq;
+	uint16_t value[SPI_SAMPLER_MAX_INPUTS];
+} wiringXSPISample_t;
+
+typedef struct wiringXSPISamplerStats_t {
+	uint64_t scans;
+	/* Deadlines that passed before the scan could start */
+	uint64_t missed;
+	/* Scans lost because the consumer did not drain the ring */
+	uint64_t dropped;
+	uint64_t errors;
+	uint64_t max_lateness_ns;
+	double rate;
+} wiringXSPISamplerStats_t;
+
+struct wiringXSPISampler_t;
+
+struct wiringXSPISampler_t *wiringXSPISamplerStart(struct wiringXSPISamplerConfig_t *);
+int wiringXSPISamplerRead(struct wiringXSPISampler_t *, struct wiringXSPISample_t *, int);
+int wiringXSPISamplerStats(struct wiringXSPISampler_t *, struct wiringXSPISamplerStats_t *);
+int wiringXSPISamplerStop(struct wiringXSPISampler_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
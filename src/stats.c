@@ -0,0 +1,94 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wiringx.h"
+#include "stats.h"
+
+#ifndef WIRINGX_NO_STATS
+struct wiringXStats_t wiringx_stats;
+#endif
+
+/*
+ * Copies the counters. Every counter is read on its
+ * own, so a snapshot taken while other threads are
+ * counting need not be consistent between counters.
+ */
+EXPORT int wiringXStats(struct wiringXStats_t *out) {
+#ifndef WIRINGX_NO_STATS
+	uint64_t *src = (uint64_t *)&wiringx_stats, *dst = (uint64_t *)out;
+	size_t i = 0;
+#endif
+
+	if(out == NULL) {
+		return -1;
+	}
+#ifndef WIRINGX_NO_STATS
+	for(i=0;i<sizeof(struct wiringXStats_t)/sizeof(uint64_t);i++) {
+		dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+	}
+	return 0;
+#else
+	memset(out, 0, sizeof(struct wiringXStats_t));
+	wiringXLog(LOG_ERR, "wiringX was built without operation counters");
+	return -1;
+#endif
+}
+
+static void stats_dump_bus(int fd, const char *name, int nr, struct wiringXBusStats_t *bus) {
+	if(bus->transactions == 0 && bus->errors == 0) {
+		return;
+	}
+	dprintf(fd, "%s %d: transactions %llu tx_bytes %llu rx_bytes %llu errors %llu\n",
+		name, nr,
+		(unsigned long long)bus->transactions, (unsigned long long)bus->tx_bytes,
+		(unsigned long long)bus->rx_bytes, (unsigned long long)bus->errors);
+}
+
+/* One line for every pin and bus that has been used */
+EXPORT int wiringXStatsDump(int fd) {
+	struct wiringXStats_t *tmp = NULL;
+	struct wiringXPinStats_t *pin = NULL;
+	int i = 0;
+
+	if((tmp = malloc(sizeof(struct wiringXStats_t))) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	if(wiringXStats(tmp) != 0) {
+		free(tmp);
+		return -1;
+	}
+
+	for(i=0;i<WIRINGX_STATS_PINS;i++) {
+		pin = &tmp->pins[i];
+		if(pin->writes == 0 && pin->reads == 0 && pin->modes == 0 &&
+		   pin->interrupts == 0 && pin->errors == 0) {
+			continue;
+		}
+		dprintf(fd, "pin %d: writes %llu reads %llu modes %llu interrupts %llu errors %llu\n",
+			i, (unsigned long long)pin->writes, (unsigned long long)pin->reads,
+			(unsigned long long)pin->modes, (unsigned long long)pin->interrupts,
+			(unsigned long long)pin->errors);
+	}
+	for(i=0;i<2;i++) {
+		stats_dump_bus(fd, "spi", i, &tmp->spi[i]);
+	}
+	for(i=0;i<WIRINGX_STATS_FDS;i++) {
+		stats_dump_bus(fd, "i2c fd", i, &tmp->i2c[i]);
+	}
+	for(i=0;i<WIRINGX_STATS_FDS;i++) {
+		stats_dump_bus(fd, "serial fd", i, &tmp->serial[i]);
+	}
+	free(tmp);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_STATS_H_
+#define _WIRINGX_STATS_H_
+
+#include "wiringx.h"
+
+/*
+ * Counting costs a relaxed atomic add per call.
+ * Failed calls only count as an error. Build with
+ * WIRINGX_NO_STATS to compile all of it out,
+ * wiringXStats then returns -1.
+ */
+#ifndef WIRINGX_NO_STATS
+
+extern struct wiringXStats_t wiringx_stats;
+
+#define STATS_ADD(counter, n) \
+	__atomic_add_fetch(&(counter), (uint64_t)(n), __ATOMIC_RELAXED)
+
+#define STATS_PIN(pin, field, ret) do { \
+	if((unsigned int)(pin) < WIRINGX_STATS_PINS) { \
+		if((ret) < 0) { \
+			STATS_ADD(wiringx_stats.pins[(pin)].errors, 1); \
+		} else { \
+			STATS_ADD(wiringx_stats.pins[(pin)].field, 1); \
+		} \
+	} \
+} while(0)
+
+#define STATS_BUS(bus, ret, tx, rx) do { \
+	if((ret) < 0) { \
+		STATS_ADD((bus).errors, 1); \
+	} else { \
+		STATS_ADD((bus).transactions, 1); \
+		STATS_ADD((bus).tx_bytes, (tx)); \
+		STATS_ADD((bus).rx_bytes, (rx)); \
+	} \
+} while(0)
+
+#define STATS_SPI(channel, ret, tx, rx) \
+	STATS_BUS(wiringx_stats.spi[(channel) & 1], ret, tx, rx)
+
+#define STATS_I2C(fd, ret, tx, rx) do { \
+	if((unsigned int)(fd) < WIRINGX_STATS_FDS) { \
+		STATS_BUS(wiringx_stats.i2c[(fd)], ret, tx, rx); \
+	} \
+} while(0)
+
+#define STATS_SERIAL(fd, ret, tx, rx) do { \
+	if((unsigned int)(fd) < WIRINGX_STATS_FDS) { \
+		STATS_BUS(wiringx_stats.serial[(fd)], ret, tx, rx); \
+	} \
+} while(0)
+
+/* A closed fd number gets reused, so its counters start over */
+#define STATS_BUS_RESET(bus) do { \
+	__atomic_store_n(&(bus).transactions, 0, __ATOMIC_RELAXED); \
+	__atomic_store_n(&(bus).tx_bytes, 0, __ATOMIC_RELAXED); \
+	__atomic_store_n(&(bus).rx_bytes, 0, __ATOMIC_RELAXED); \
+	__atomic_store_n(&(bus).errors, 0, __ATOMIC_RELAXED); \
+} while(0)
+
+#define STATS_I2C_RESET(fd) do { \
+	if((unsigned int)(fd) < WIRINGX_STATS_FDS) { \
+		STATS_BUS_RESET(wiringx_stats.i2c[(fd)]); \
+	} \
+} while(0)
+
+#define STATS_SERIAL_RESET(fd) do { \
+	if((unsigned int)(fd) < WIRINGX_STATS_FDS) { \
+		STATS_BUS_RESET(wiringx_stats.serial[(fd)]); \
+	} \
+} while(0)
+
+#else
+
+#define STATS_PIN(pin, field, ret) do { } while(0)
+#define STATS_SPI(channel, ret, tx, rx) do { } while(0)
+#define STATS_I2C(fd, ret, tx, rx) do { } while(0)
+#define STATS_SERIAL(fd, ret, tx, rx) do { } while(0)
+#define STATS_I2C_RESET(fd) do { } while(0)
+#define STATS_SERIAL_RESET(fd) do { } while(0)
+
+#endif
+
+#endif
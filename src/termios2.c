@@ -0,0 +1,61 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef __FreeBSD__
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+
+#include "termios2.h"
+
+#if defined(TCGETS2) && defined(TCSETS2) && defined(BOTHER)
+
+int termios2_set_baud(int fd, unsigned int baud) {
+	struct termios2 options;
+
+	if(ioctl(fd, TCGETS2, &options) < 0) {
+		return -1;
+	}
+
+	options.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	options.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+	options.c_ispeed = baud;
+	options.c_ospeed = baud;
+
+	return ioctl(fd, TCSETS2, &options);
+}
+
+/* Drivers write back the rate they could actually program */
+int termios2_get_baud(int fd, unsigned int *baud) {
+	struct termios2 options;
+
+	if(ioctl(fd, TCGETS2, &options) < 0) {
+		return -1;
+	}
+	*baud = options.c_ospeed;
+
+	return 0;
+}
+
+#else
+
+int termios2_set_baud(int fd, unsigned int baud) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+int termios2_get_baud(int fd, unsigned int *baud) {
+	errno = ENOTSUP;
+	return -1;
+}
+
+#endif
+
+#endif
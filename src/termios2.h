@@ -0,0 +1,20 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_TERMIOS2_H_
+#define _WIRINGX_TERMIOS2_H_
+
+/*
+ * The kernel termios2 structure clashes with the
+ * libc termios one, so arbitrary baud rates are
+ * handled in a separate translation unit.
+ */
+int termios2_set_baud(int fd, unsigned int baud);
+int termios2_get_baud(int fd, unsigned int *baud);
+
+#endif
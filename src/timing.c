@@ -0,0 +1,360 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "wiringx.h"
+#include "histogram.h"
+#include "timing.h"
+
+#ifndef WIRINGX_NO_STATS
+
+#define TIMING_MAX_APIS	128
+#define TIMING_MAX_KEYS	256
+
+/*
+ * A call is only counted once, in the histogram of
+ * its key or in total when it has none. The totals
+ * of a function are merged when reading.
+ */
+typedef struct timing_api_t {
+	const char *name;
+	struct histogram_t *total;
+	/* Allocated on the first call with a key */
+	struct histogram_t **keys;
+} timing_api_t;
+
+typedef struct timing_dump_t {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t signal;
+	int running;
+	int fd;
+	unsigned int interval_ms;
+} timing_dump_t;
+
+int timing_enabled = 0;
+
+static struct timing_api_t apis[TIMING_MAX_APIS];
+static int nrapis = 0;
+static pthread_mutex_t apilock = PTHREAD_MUTEX_INITIALIZER;
+static struct timing_dump_t *dump = NULL;
+
+static uint64_t timing_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *timing_alloc(size_t size) {
+	void *tmp = NULL;
+
+	if((tmp = calloc(1, size)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	return tmp;
+}
+
+/* Functions get their slot on the first timed call */
+static int timing_register(int *api, const char *name) {
+	int ret = 0;
+
+	pthread_mutex_lock(&apilock);
+	if((ret = __atomic_load_n(api, __ATOMIC_ACQUIRE)) < 0) {
+		if(nrapis == TIMING_MAX_APIS) {
+			pthread_mutex_unlock(&apilock);
+			return -1;
+		}
+		ret = nrapis;
+		apis[ret].name = name;
+		apis[ret].total = timing_alloc(sizeof(struct histogram_t));
+		__atomic_store_n(&nrapis, nrapis + 1, __ATOMIC_RELEASE);
+		__atomic_store_n(api, ret, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&apilock);
+
+	return ret;
+}
+
+/* Two threads may race to install one, the loser frees its copy */
+static void *timing_install(void **slot, size_t size) {
+	void *tmp = NULL, *expected = NULL;
+
+	if((tmp = __atomic_load_n(slot, __ATOMIC_ACQUIRE)) != NULL) {
+		return tmp;
+	}
+	tmp = timing_alloc(size);
+	if(__atomic_compare_exchange_n(slot, &expected, tmp, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) == 0) {
+		free(tmp);
+		return expected;
+	}
+	return tmp;
+}
+
+struct timing_t timing_begin(int *api, const char *name, int key) {
+	struct timing_t tmp;
+
+	if((tmp.api = __atomic_load_n(api, __ATOMIC_ACQUIRE)) < 0) {
+		tmp.api = timing_register(api, name);
+	}
+	tmp.key = key;
+	tmp.start = timing_now();
+
+	return tmp;
+}
+
+void timing_end(struct timing_t *timing) {
+	struct timing_api_t *api = NULL;
+	struct histogram_t **keys = NULL, *histogram = NULL;
+	uint64_t ns = 0;
+
+	if(timing->api < 0) {
+		return;
+	}
+	ns = timing_now() - timing->start;
+	api = &apis[timing->api];
+
+	if(timing->key >= 0 && timing->key < TIMING_MAX_KEYS) {
+		keys = timing_install((void **)&api->keys, sizeof(struct histogram_t *)*TIMING_MAX_KEYS);
+		histogram = timing_install((void **)&keys[timing->key], sizeof(struct histogram_t));
+	} else {
+		histogram = api->total;
+	}
+	histogram_add(histogram, ns);
+}
+
+static void timing_fill(struct wiringXTiming_t *out, const char *name, int key, struct histogram_t *histogram) {
+	out->name = name;
+	out->key = key;
+	out->count = histogram_count(histogram);
+	out->p50_ns = histogram_percentile(histogram, 50.0);
+	out->p90_ns = histogram_percentile(histogram, 90.0);
+	out->p99_ns = histogram_percentile(histogram, 99.0);
+	out->p999_ns = histogram_percentile(histogram, 99.9);
+	out->max_ns = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+}
+
+static void timing_write(int fd) {
+	struct wiringXTiming_t *timings = NULL;
+	char key[16];
+	int n = 0, i = 0;
+
+	if((n = wiringXTimingSnapshot(&timings)) <= 0) {
+		return;
+	}
+	for(i=0;i<n;i++) {
+		key[0] = 0;
+		if(timings[i].key >= 0) {
+			snprintf(key, sizeof(key), "[%d]", timings[i].key);
+		}
+		dprintf(fd, "%s%s: count %llu p50 %llu p90 %llu p99 %llu p99.9 %llu max %llu ns\n",
+			timings[i].name, key, (unsigned long long)timings[i].count,
+			(unsigned long long)timings[i].p50_ns, (unsigned long long)timings[i].p90_ns,
+			(unsigned long long)timings[i].p99_ns, (unsigned long long)timings[i].p999_ns,
+			(unsigned long long)timings[i].max_ns);
+	}
+	free(timings);
+}
+
+static void *timing_dump_thread(void *param) {
+	struct timing_dump_t *tmp = param;
+	struct timespec ts;
+	uint64_t deadline = timing_now();
+	int ret = 0;
+
+	pthread_mutex_lock(&tmp->lock);
+	while(tmp->running == 1) {
+		deadline += (uint64_t)tmp->interval_ms * 1000000ULL;
+		ts.tv_sec = (time_t)(deadline / 1000000000ULL);
+		ts.tv_nsec = (long)(deadline % 1000000000ULL);
+
+		ret = 0;
+		while(tmp->running == 1 && ret != ETIMEDOUT) {
+			ret = pthread_cond_timedwait(&tmp->signal, &tmp->lock, &ts);
+		}
+		if(tmp->running == 1) {
+			timing_write(tmp->fd);
+		}
+	}
+	pthread_mutex_unlock(&tmp->lock);
+
+	return NULL;
+}
+
+static void timing_dump_stop(void) {
+	if(dump == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&dump->lock);
+	dump->running = 0;
+	pthread_cond_broadcast(&dump->signal);
+	pthread_mutex_unlock(&dump->lock);
+
+	pthread_join(dump->thread, NULL);
+	pthread_mutex_destroy(&dump->lock);
+	pthread_cond_destroy(&dump->signal);
+	free(dump);
+	dump = NULL;
+}
+
+#endif
+
+/*
+ * Switches the timing of the public functions on
+ * or off. The histograms are kept when switched off,
+ * wiringXTimingReset clears them.
+ */
+EXPORT int wiringXTiming(int enable) {
+#ifndef WIRINGX_NO_STATS
+	__atomic_store_n(&timing_enabled, (enable != 0) ? 1 : 0, __ATOMIC_RELAXED);
+	if(enable == 0) {
+		timing_dump_stop();
+	}
+	return 0;
+#else
+	wiringXLog(LOG_ERR, "wiringX was built without timing support");
+	return -1;
+#endif
+}
+
+/*
+ * One entry per timed function, followed by one per
+ * pin, SPI channel or fd it was called with. Returns
+ * the number of entries, the array must be freed.
+ */
+EXPORT int wiringXTimingSnapshot(struct wiringXTiming_t **out) {
+#ifndef WIRINGX_NO_STATS
+	struct histogram_t **keys = NULL, *histogram = NULL, *merged = NULL;
+	int total = 0, n = 0, i = 0, x = 0;
+
+	*out = NULL;
+
+	total = __atomic_load_n(&nrapis, __ATOMIC_ACQUIRE);
+	for(i=0;i<__atomic_load_n(&nrapis, __ATOMIC_ACQUIRE);i++) {
+		if((keys = __atomic_load_n(&apis[i].keys, __ATOMIC_ACQUIRE)) != NULL) {
+			for(x=0;x<TIMING_MAX_KEYS;x++) {
+				total += (__atomic_load_n(&keys[x], __ATOMIC_ACQUIRE) != NULL) ? 1 : 0;
+			}
+		}
+	}
+	if(total == 0) {
+		return 0;
+	}
+	if((*out = malloc(sizeof(struct wiringXTiming_t)*(size_t)total)) == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(-1);
+	}
+	merged = timing_alloc(sizeof(struct histogram_t));
+
+	/* Functions or keys added since counting are left out */
+	for(i=0;i<__atomic_load_n(&nrapis, __ATOMIC_ACQUIRE) && n < total;i++) {
+		keys = __atomic_load_n(&apis[i].keys, __ATOMIC_ACQUIRE);
+
+		histogram_reset(merged);
+		histogram_merge(merged, apis[i].total);
+		for(x=0;keys!=NULL&&x<TIMING_MAX_KEYS;x++) {
+			if((histogram = __atomic_load_n(&keys[x], __ATOMIC_ACQUIRE)) != NULL) {
+				histogram_merge(merged, histogram);
+			}
+		}
+		if(histogram_count(merged) > 0) {
+			timing_fill(&(*out)[n++], apis[i].name, -1, merged);
+		}
+
+		for(x=0;keys!=NULL&&x<TIMING_MAX_KEYS&&n<total;x++) {
+			if((histogram = __atomic_load_n(&keys[x], __ATOMIC_ACQUIRE)) != NULL &&
+			   histogram_count(histogram) > 0) {
+				timing_fill(&(*out)[n++], apis[i].name, x, histogram);
+			}
+		}
+	}
+	free(merged);
+	if(n == 0) {
+		free(*out);
+		*out = NULL;
+	}
+
+	return n;
+#else
+	*out = NULL;
+	wiringXLog(LOG_ERR, "wiringX was built without timing support");
+	return -1;
+#endif
+}
+
+/* Calls that finish while resetting may be lost */
+EXPORT void wiringXTimingReset(void) {
+#ifndef WIRINGX_NO_STATS
+	struct histogram_t **keys = NULL, *histogram = NULL;
+	int i = 0, x = 0;
+
+	for(i=0;i<__atomic_load_n(&nrapis, __ATOMIC_ACQUIRE);i++) {
+		histogram_reset(apis[i].total);
+		if((keys = __atomic_load_n(&apis[i].keys, __ATOMIC_ACQUIRE)) == NULL) {
+			continue;
+		}
+		for(x=0;x<TIMING_MAX_KEYS;x++) {
+			if((histogram = __atomic_load_n(&keys[x], __ATOMIC_ACQUIRE)) != NULL) {
+				histogram_reset(histogram);
+			}
+		}
+	}
+#endif
+}
+
+/*
+ * Writes the percentiles of every timed function to
+ * fd. With an interval this is repeated from a thread
+ * every interval_ms until wiringXTiming(0) or a call
+ * with a negative fd, which stops the thread.
+ */
+EXPORT int wiringXTimingDump(int fd, unsigned int interval_ms) {
+#ifndef WIRINGX_NO_STATS
+	pthread_condattr_t attr;
+	int ret = 0;
+
+	timing_dump_stop();
+	if(fd < 0) {
+		return 0;
+	}
+	if(interval_ms == 0) {
+		timing_write(fd);
+		return 0;
+	}
+
+	dump = timing_alloc(sizeof(struct timing_dump_t));
+	dump->fd = fd;
+	dump->interval_ms = interval_ms;
+	dump->running = 1;
+	pthread_mutex_init(&dump->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&dump->signal, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if((ret = pthread_create(&dump->thread, NULL, timing_dump_thread, dump)) != 0) {
+		wiringXLog(LOG_ERR, "wiringX failed to start the timing dump thread (%s)", strerror(ret));
+		pthread_mutex_destroy(&dump->lock);
+		pthread_cond_destroy(&dump->signal);
+		free(dump);
+		dump = NULL;
+		return -1;
+	}
+	return 0;
+#else
+	wiringXLog(LOG_ERR, "wiringX was built without timing support");
+	return -1;
+#endif
+}
@@ -0,0 +1,56 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#ifndef _WIRINGX_TIMING_H_
+#define _WIRINGX_TIMING_H_
+
+#include "wiringx.h"
+
+/*
+ * TIMING(key) as the first line of a function
+ * records how long the call took, once for the
+ * function and once for the key (pin, SPI channel
+ * or fd) when it is not negative. The record is
+ * taken when the function returns, on whichever
+ * path. While timing is off it costs a load and
+ * a branch, WIRINGX_NO_STATS compiles it out.
+ */
+#ifndef WIRINGX_NO_STATS
+
+typedef struct timing_t {
+	int api;
+	int key;
+	uint64_t start;
+} timing_t;
+
+extern int timing_enabled;
+
+struct timing_t timing_begin(int *api, const char *name, int key);
+void timing_end(struct timing_t *);
+
+static inline struct timing_t timing_start(int *api, const char *name, int key) {
+	struct timing_t tmp = { -1, -1, 0 };
+
+	if(__atomic_load_n(&timing_enabled, __ATOMIC_RELAXED) == 1) {
+		return timing_begin(api, name, key);
+	}
+	return tmp;
+}
+
+#define TIMING(key) \
+	static int timing_api = -1; \
+	struct timing_t timing __attribute__((cleanup(timing_end))) = \
+		timing_start(&timing_api, __func__, (key))
+
+#else
+
+#define TIMING(key)
+
+#endif
+
+#endif
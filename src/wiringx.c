@@ -16,15 +16,23 @@
 #include <fcntl.h>
 #include <time.h>
 #include <termios.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
+#include <sys/file.h>
 #ifndef __FreeBSD__
 	#include <linux/spi/spidev.h>
+	#include <linux/serial.h>
 	#include "i2c-dev.h"
+	#include "termios2.h"
 #endif
 
 #include "wiringx.h"
+#include "stats.h"
+#include "timing.h"
+#include "rs485.h"
 
 #include "soc/allwinner/a10.h"
 #include "soc/allwinner/a31s.h"
@@ -78,17 +86,31 @@ static int isinit = 0;
 /* SPI Bus Parameters */
 
 struct spi_t {
-	uint8_t mode;
+	uint32_t mode;
 	uint8_t bits_per_word;
 	uint16_t delay;
 	uint32_t speed;
 	int fd;
+	int direct;
 } spi_t;
 
 static struct spi_t spi[2] = {
-	{ 0, 0, 0, 0, 0 },
-	{ 0, 0, 0, 0, 0 }
+	{ 0, 0, 0, 0, 0, 0 },
+	{ 0, 0, 0, 0, 0, 0 }
 };
+
+static const char *spi_device[2] = {
+	"/dev/spidev0.0",
+	"/dev/spidev0.1"
+};
+
+/* Lock only handles on chip selects wiringX did not open */
+static int spi_lock[2] = { -1, -1 };
+
+/* I2C slave address per fd, I2C_RDWR messages need it */
+static pthread_mutex_t i2c_addr_lock = PTHREAD_MUTEX_INITIALIZER;
+static int *i2c_addr = NULL;
+static int i2c_addr_size = 0;
 #endif
 
 #ifdef _WIN32
@@ -134,6 +156,7 @@ static void delayMicrosecondsHard(unsigned int howLong) {
 }
 
 EXPORT void delayMicroseconds(unsigned int howLong) {
+	TIMING(-1);
 	struct timespec sleeper;
 #ifdef _WIN32
 	long int uSecs = howLong % 1000000;
@@ -271,6 +294,7 @@ static void wiringXInit(void) {
 }
 
 EXPORT int wiringXSetup(char *name, void (*func)(int, char *, int, const char *, ...)) {
+	TIMING(-1);
 	if(issetup == 0) {
 		issetup = 1;
 	} else {
@@ -305,7 +329,24 @@ EXPORT int wiringXSetup(char *name, void (*func)(int, char *, int, const char *,
 	return 0;
 }
 
+/*
+ * Backs the SoC registers with shared memory instead
+ * of /dev/mem, so a platform can be setup and its
+ * GPIO functions run and timed on any Linux machine.
+ * Has to be called before wiringXSetup.
+ */
+EXPORT int wiringXSimulate(int enable) {
+	TIMING(-1);
+	if(issetup == 1) {
+		wiringXLog(LOG_ERR, "wiringX can only simulate the hardware before wiringXSetup");
+		return -1;
+	}
+	soc_mem_set((enable == 1) ? &soc_mem_sim : NULL);
+	return 0;
+}
+
 EXPORT char *wiringXPlatform(void) {
+	TIMING(-1);
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return NULL;
@@ -314,6 +355,9 @@ EXPORT char *wiringXPlatform(void) {
 }
 
 EXPORT int pinMode(int pin, enum pinmode_t mode) {
+	TIMING(pin);
+	int ret = 0;
+
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -321,10 +365,15 @@ EXPORT int pinMode(int pin, enum pinmode_t mode) {
 		wiringXLog(LOG_ERR, "The %s does not support the pinMode functionality", platform->name[namenr]);
 		return -1;
 	}
-	return platform->pinMode(pin, mode);
+	ret = platform->pinMode(pin, mode);
+	STATS_PIN(pin, modes, ret);
+	return ret;
 }
 
 EXPORT int digitalWrite(int pin, enum digital_value_t value) {
+	TIMING(pin);
+	int ret = 0;
+
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -332,10 +381,15 @@ EXPORT int digitalWrite(int pin, enum digital_value_t value) {
 		wiringXLog(LOG_ERR, "The %s does not support the digitalWrite functionality", platform->name[namenr]);
 		return -1;
 	}
-	return platform->digitalWrite(pin, value);
+	ret = platform->digitalWrite(pin, value);
+	STATS_PIN(pin, writes, ret);
+	return ret;
 }
 
 EXPORT int digitalRead(int pin) {
+	TIMING(pin);
+	int ret = 0;
+
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -343,10 +397,15 @@ EXPORT int digitalRead(int pin) {
 		wiringXLog(LOG_ERR, "The %s does not support the digitalRead functionality", platform->name[namenr]);
 		return -1;
 	}
-	return platform->digitalRead(pin);
+	ret = platform->digitalRead(pin);
+	STATS_PIN(pin, reads, ret);
+	return ret;
 }
 
 EXPORT int wiringXISR(int pin, enum isr_mode_t mode) {
+	TIMING(pin);
+	int ret = 0;
+
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -354,10 +413,15 @@ EXPORT int wiringXISR(int pin, enum isr_mode_t mode) {
 		wiringXLog(LOG_ERR, "The %s does not support the wiringXISR functionality", platform->name[namenr]);
 		return -1;
 	}
-	return platform->isr(pin, mode);
+	ret = platform->isr(pin, mode);
+	STATS_PIN(pin, modes, ret);
+	return ret;
 }
 
 EXPORT int waitForInterrupt(int pin, int ms) {
+	TIMING(pin);
+	int ret = 0;
+
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -365,10 +429,16 @@ EXPORT int waitForInterrupt(int pin, int ms) {
 		wiringXLog(LOG_ERR, "The %s does not support the waitForInterrupt functionality", platform->name[namenr]);
 		return -1;
 	}
-	return platform->waitForInterrupt(pin, ms);
+	ret = platform->waitForInterrupt(pin, ms);
+	/* Timeouts are neither an interrupt nor an error */
+	if(ret != 0) {
+		STATS_PIN(pin, interrupts, ret);
+	}
+	return ret;
 }
 
 EXPORT int wiringXValidGPIO(int pin) {
+	TIMING(pin);
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -381,30 +451,107 @@ EXPORT int wiringXValidGPIO(int pin) {
 
 #ifndef __FreeBSD__
 EXPORT int wiringXI2CRead(int fd) {
-	return i2c_smbus_read_byte(fd);
+	TIMING(fd);
+	int ret = i2c_smbus_read_byte(fd);
+
+	STATS_I2C(fd, ret, 0, 1);
+	return ret;
 }
 
 EXPORT int wiringXI2CReadReg8(int fd, int reg) {
-	return i2c_smbus_read_byte_data(fd, reg);
+	TIMING(fd);
+	int ret = i2c_smbus_read_byte_data(fd, reg);
+
+	STATS_I2C(fd, ret, 1, 1);
+	return ret;
 }
 
 EXPORT int wiringXI2CReadReg16(int fd, int reg) {
-	return i2c_smbus_read_word_data(fd, reg);
+	TIMING(fd);
+	int ret = i2c_smbus_read_word_data(fd, reg);
+
+	STATS_I2C(fd, ret, 1, 2);
+	return ret;
 }
 
 EXPORT int wiringXI2CWrite(int fd, int data) {
-	return i2c_smbus_write_byte(fd, data);
+	TIMING(fd);
+	int ret = i2c_smbus_write_byte(fd, data);
+
+	STATS_I2C(fd, ret, 1, 0);
+	return ret;
 }
 
 EXPORT int wiringXI2CWriteReg8(int fd, int reg, int data) {
-	return i2c_smbus_write_byte_data(fd, reg, data);
+	TIMING(fd);
+	int ret = i2c_smbus_write_byte_data(fd, reg, data);
+
+	STATS_I2C(fd, ret, 2, 0);
+	return ret;
 }
 
 EXPORT int wiringXI2CWriteReg16(int fd, int reg, int data) {
-	return i2c_smbus_write_word_data(fd, reg, data);
+	TIMING(fd);
+	int ret = i2c_smbus_write_word_data(fd, reg, data);
+
+	STATS_I2C(fd, ret, 3, 0);
+	return ret;
+}
+
+/*
+ * buf must hold I2C_BLOCK_MAX bytes, the
+ * device decides how many are returned.
+ */
+EXPORT int wiringXI2CReadBlock(int fd, int reg, unsigned char *buf) {
+	TIMING(fd);
+	int ret = i2c_smbus_read_block_data(fd, reg, buf);
+
+	/* The count byte comes first */
+	STATS_I2C(fd, ret, 1, ret + 1);
+	return ret;
+}
+
+EXPORT int wiringXI2CWriteBlock(int fd, int reg, const unsigned char *buf, int len) {
+	TIMING(fd);
+	int ret = 0;
+
+	if(len < 0 || len > I2C_BLOCK_MAX) {
+		wiringXLog(LOG_ERR, "wiringX can write 0 to %d bytes in one I2C block", I2C_BLOCK_MAX);
+		return -1;
+	}
+	ret = i2c_smbus_write_block_data(fd, reg, len, buf);
+	STATS_I2C(fd, ret, len + 2, 0);
+	return ret;
+}
+
+EXPORT int wiringXI2CReadI2CBlock(int fd, int reg, unsigned char *buf, int len) {
+	TIMING(fd);
+	int ret = 0;
+
+	if(len <= 0 || len > I2C_BLOCK_MAX) {
+		wiringXLog(LOG_ERR, "wiringX can read 1 to %d bytes in one I2C block", I2C_BLOCK_MAX);
+		return -1;
+	}
+	ret = i2c_smbus_read_i2c_block_data(fd, reg, len, buf);
+	STATS_I2C(fd, ret, 1, ret);
+	return ret;
+}
+
+EXPORT int wiringXI2CWriteI2CBlock(int fd, int reg, const unsigned char *buf, int len) {
+	TIMING(fd);
+	int ret = 0;
+
+	if(len <= 0 || len > I2C_BLOCK_MAX) {
+		wiringXLog(LOG_ERR, "wiringX can write 1 to %d bytes in one I2C block", I2C_BLOCK_MAX);
+		return -1;
+	}
+	ret = i2c_smbus_write_i2c_block_data(fd, reg, len, buf);
+	STATS_I2C(fd, ret, len + 1, 0);
+	return ret;
 }
 
 EXPORT int wiringXI2CSetup(const char *path, int devId) {
+	TIMING(-1);
 	int fd = 0;
 
 	if((fd = open(path, O_RDWR)) < 0) {
@@ -414,50 +561,305 @@ EXPORT int wiringXI2CSetup(const char *path, int devId) {
 
 	if(ioctl(fd, I2C_SLAVE, devId) < 0) {
 		wiringXLog(LOG_ERR, "wiringX failed to set %s to slave mode", path);
+		close(fd);
 		return -1;
 	}
 
+	pthread_mutex_lock(&i2c_addr_lock);
+	if(fd >= i2c_addr_size) {
+		if((i2c_addr = realloc(i2c_addr, sizeof(int)*(fd+1))) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+		while(i2c_addr_size <= fd) {
+			i2c_addr[i2c_addr_size++] = -1;
+		}
+	}
+	i2c_addr[fd] = devId;
+	pthread_mutex_unlock(&i2c_addr_lock);
+
 	return fd;
 }
 
+EXPORT void wiringXI2CClose(int fd) {
+	TIMING(fd);
+	if(fd <= 0) {
+		return;
+	}
+	/* Forget the address before the fd number can be reused */
+	pthread_mutex_lock(&i2c_addr_lock);
+	if(fd < i2c_addr_size) {
+		i2c_addr[fd] = -1;
+	}
+	pthread_mutex_unlock(&i2c_addr_lock);
+	STATS_I2C_RESET(fd);
+	close(fd);
+}
+
+static int wiringXI2CGetAddr(int fd) {
+	int addr = -1;
+
+	pthread_mutex_lock(&i2c_addr_lock);
+	if(fd >= 0 && fd < i2c_addr_size) {
+		addr = i2c_addr[fd];
+	}
+	pthread_mutex_unlock(&i2c_addr_lock);
+
+	if(addr == -1) {
+		wiringXLog(LOG_ERR, "wiringX I2C fd %d has not been setup by wiringXI2CSetup", fd);
+		return -1;
+	}
+	return addr;
+}
+
+EXPORT int wiringXI2CTransfer(int fd, struct wiringXI2CMsg_t *msgs, int n) {
+	TIMING(fd);
+	struct i2c_msg tmp[I2C_RDWR_MAX_MSGS];
+	size_t tx = 0, rx = 0;
+	int i = 0, ret = 0;
+
+	if(n <= 0 || n > I2C_RDWR_MAX_MSGS) {
+		wiringXLog(LOG_ERR, "wiringX cannot send %d I2C messages in one transfer", n);
+		return -1;
+	}
+
+	for(i=0;i<n;i++) {
+		tmp[i].addr = msgs[i].addr;
+		tmp[i].flags = msgs[i].flags;
+		tmp[i].len = msgs[i].len;
+		tmp[i].buf = msgs[i].buf;
+		if((msgs[i].flags & I2C_M_RD) == I2C_M_RD) {
+			rx += msgs[i].len;
+		} else {
+			tx += msgs[i].len;
+		}
+	}
+
+	ret = i2c_rdwr(fd, tmp, n);
+	STATS_I2C(fd, ret, tx, rx);
+	if(ret < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Register address write followed by a repeated
+ * start read, all in a single ioctl.
+ */
+EXPORT int wiringXI2CReadRegs(int fd, int reg, unsigned char *buf, int len) {
+	TIMING(fd);
+	struct i2c_msg msgs[2];
+	unsigned char cmd = (unsigned char)reg;
+	int addr = 0, ret = 0;
+
+	if(len < 1 || len > I2C_RDWR_MAX_LEN) {
+		wiringXLog(LOG_ERR, "wiringX can read 1 to %d bytes in one I2C message", I2C_RDWR_MAX_LEN);
+		return -1;
+	}
+	if((addr = wiringXI2CGetAddr(fd)) == -1) {
+		return -1;
+	}
+
+	msgs[0].addr = addr;
+	msgs[0].flags = 0;
+	msgs[0].len = 1;
+	msgs[0].buf = &cmd;
+
+	msgs[1].addr = addr;
+	msgs[1].flags = I2C_M_RD;
+	msgs[1].len = len;
+	msgs[1].buf = buf;
+
+	ret = i2c_rdwr(fd, msgs, 2);
+	STATS_I2C(fd, ret, 1, len);
+	if(ret < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+EXPORT int wiringXI2CWriteRegs(int fd, int reg, const unsigned char *buf, int len) {
+	TIMING(fd);
+	unsigned char stack[64], *tmp = stack;
+	struct i2c_msg msg;
+	int addr = 0, ret = 0;
+
+	if(len < 1 || len > I2C_RDWR_MAX_LEN - 1) {
+		wiringXLog(LOG_ERR, "wiringX can write 1 to %d bytes after the register in one I2C message", I2C_RDWR_MAX_LEN - 1);
+		return -1;
+	}
+	if((addr = wiringXI2CGetAddr(fd)) == -1) {
+		return -1;
+	}
+
+	if(len+1 > (int)sizeof(stack)) {
+		if((tmp = malloc(len+1)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+	}
+	tmp[0] = (unsigned char)reg;
+	memcpy(&tmp[1], buf, len);
+
+	msg.addr = addr;
+	msg.flags = 0;
+	msg.len = len+1;
+	msg.buf = tmp;
+
+	if(i2c_rdwr(fd, &msg, 1) < 0) {
+		ret = -1;
+	}
+	STATS_I2C(fd, ret, len + 1, 0);
+
+	if(tmp != stack) {
+		free(tmp);
+	}
+	return ret;
+}
+
 EXPORT int wiringXSPIGetFd(int channel) {
+	TIMING(channel & 1);
 	return spi[channel & 1].fd;
 }
 
 EXPORT int wiringXSPIDataRW(int channel, unsigned char *data, int len) {
+	TIMING(channel & 1);
 	struct spi_ioc_transfer tmp;
+	int ret = 0;
 	memset(&tmp, 0, sizeof(tmp));
 	channel &= 1;
 
+	if(spi[channel].direct == 1) {
+		ret = platform->spiDataRW(channel, data, len);
+		STATS_SPI(channel, ret, len, len);
+		return ret;
+	}
+
 	tmp.tx_buf = (uintptr_t)data;
 	tmp.rx_buf = (uintptr_t)data;
 	tmp.len = len;
 	tmp.delay_usecs = spi[channel].delay;
 	tmp.speed_hz = spi[channel].speed;
 	tmp.bits_per_word = spi[channel].bits_per_word;
+
+	if(ioctl(spi[channel].fd, SPI_IOC_MESSAGE(1), &tmp) < 0) {
+		wiringXLog(LOG_ERR, "wiringX is unable to read/write from channel %d (%s)", channel, strerror(errno));
+		ret = -1;
+	}
+	STATS_SPI(channel, ret, len, len);
+	return ret;
+}
+
+EXPORT int wiringXSPITransfer(int channel, struct wiringXSPITransfer_t *xfers, int n) {
+	TIMING(channel & 1);
+	struct spi_ioc_transfer stack[16], *tmp = stack;
+	size_t tx = 0, rx = 0;
+	int i = 0, ret = 0;
+
+	channel &= 1;
+
+	if(spi[channel].direct == 1) {
+		wiringXLog(LOG_ERR, "wiringX SPI channel %d is in direct mode, release it before using spidev transfers", channel);
+		return -1;
+	}
+	if(n <= 0 || n > 511) {
+		wiringXLog(LOG_ERR, "wiringX cannot send %d SPI segments in one message", n);
+		return -1;
+	}
+	if(n > 16) {
+		if((tmp = malloc(sizeof(struct spi_ioc_transfer)*n)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+	}
+	memset(tmp, 0, sizeof(struct spi_ioc_transfer)*n);
+
+	for(i=0;i<n;i++) {
+		tmp[i].tx_buf = (uintptr_t)xfers[i].tx;
+		tmp[i].rx_buf = (uintptr_t)xfers[i].rx;
+		tmp[i].len = xfers[i].len;
+		tmp[i].delay_usecs = (xfers[i].delay > 0) ? xfers[i].delay : spi[channel].delay;
+		tmp[i].speed_hz = (xfers[i].speed > 0) ? xfers[i].speed : spi[channel].speed;
+		tmp[i].bits_per_word = (xfers[i].bits_per_word > 0) ? xfers[i].bits_per_word : spi[channel].bits_per_word;
+		tmp[i].cs_change = xfers[i].cs_change;
+		tx += (xfers[i].tx != NULL) ? xfers[i].len : 0;
+		rx += (xfers[i].rx != NULL) ? xfers[i].len : 0;
 #ifdef SPI_IOC_WR_MODE32
-	tmp.tx_nbits = 0;
+		tmp[i].tx_nbits = xfers[i].tx_nbits;
+		tmp[i].rx_nbits = xfers[i].rx_nbits;
+#else
+		if(xfers[i].tx_nbits > 1 || xfers[i].rx_nbits > 1) {
+			wiringXLog(LOG_ERR, "wiringX was built without dual / quad SPI support");
+			ret = -1;
+			break;
+		}
 #endif
-#ifdef SPI_IOC_RD_MODE32
-	tmp.rx_nbits = 0;
+	}
+
+	if(ret == 0 && ioctl(spi[channel].fd, SPI_IOC_MESSAGE(n), tmp) < 0) {
+		wiringXLog(LOG_ERR, "wiringX is unable to transfer %d segments on channel %d (%s)", n, channel, strerror(errno));
+		ret = -1;
+	}
+	STATS_SPI(channel, ret, tx, rx);
+
+	if(tmp != stack) {
+		free(tmp);
+	}
+	return ret;
+}
+
+static int wiringXSPISetMode(int channel, const char *device) {
+	uint8_t mode = 0;
+
+#ifdef SPI_IOC_WR_MODE32
+	/*
+	 * The 8-bit ioctl cannot carry the dual / quad
+	 * and other extended mode bits.
+	 */
+	if(spi[channel].mode > 0xFF) {
+		if(ioctl(spi[channel].fd, SPI_IOC_WR_MODE32, &spi[channel].mode) < 0) {
+			wiringXLog(LOG_ERR, "wiringX is unable to set write mode 0x%x for device %s (%s)", spi[channel].mode, device, strerror(errno));
+			return -1;
+		}
+		if(ioctl(spi[channel].fd, SPI_IOC_RD_MODE32, &spi[channel].mode) < 0) {
+			wiringXLog(LOG_ERR, "wiringX is unable to set read mode for device %s (%s)", device, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+#else
+	if(spi[channel].mode > 0xFF) {
+		wiringXLog(LOG_ERR, "wiringX was built without support for SPI mode 0x%x", spi[channel].mode);
+		return -1;
+	}
 #endif
 
-	if(ioctl(spi[channel].fd, SPI_IOC_MESSAGE(1), &tmp) < 0) {
-		wiringXLog(LOG_ERR, "wiringX is unable to read/write from channel %d (%s)", channel, strerror(errno));
+	mode = (uint8_t)spi[channel].mode;
+	if(ioctl(spi[channel].fd, SPI_IOC_WR_MODE, &mode) < 0) {
+		wiringXLog(LOG_ERR, "wiringX is unable to set write mode for device %s (%s)", device, strerror(errno));
+		return -1;
+	}
+
+	if(ioctl(spi[channel].fd, SPI_IOC_RD_MODE, &mode) < 0) {
+		wiringXLog(LOG_ERR, "wiringX is unable to set read mode for device %s (%s)", device, strerror(errno));
 		return -1;
 	}
+	spi[channel].mode = mode;
+
 	return 0;
 }
 
-EXPORT int wiringXSPISetup(int channel, int speed) {
+EXPORT int wiringXSPISetupMode(int channel, int speed, unsigned int mode) {
+	TIMING(channel & 1);
 	const char *device = NULL;
 
 	channel &= 1;
+	device = spi_device[channel];
 
-	if(channel == 0) {
-		device = "/dev/spidev0.0";
-	} else {
-		device = "/dev/spidev0.1";
+	if(spi[channel].direct == 1) {
+		wiringXLog(LOG_ERR, "wiringX SPI channel %d is in direct mode, release it before changing its setup", channel);
+		return -1;
 	}
 
 	if((spi[channel].fd = open(device, O_RDWR)) < 0) {
@@ -465,16 +867,21 @@ EXPORT int wiringXSPISetup(int channel, int speed) {
 		return -1;
 	}
 
-	spi[channel].speed = speed;
-
-	if(ioctl(spi[channel].fd, SPI_IOC_WR_MODE, &spi[channel].mode) < 0) {
-		wiringXLog(LOG_ERR, "wiringX is unable to set write mode for device %s (%s)", device, strerror(errno));
+	/*
+	 * A shared lock for as long as the device is open,
+	 * direct mode needs an exclusive one on both chip
+	 * selects and so waits for every spidev user.
+	 */
+	if(flock(spi[channel].fd, LOCK_SH | LOCK_NB) < 0) {
+		wiringXLog(LOG_ERR, "wiringX SPI device %s is in direct use by another process (%s)", device, strerror(errno));
 		close(spi[channel].fd);
 		return -1;
 	}
 
-	if(ioctl(spi[channel].fd, SPI_IOC_RD_MODE, &spi[channel].mode) < 0) {
-		wiringXLog(LOG_ERR, "wiringX is unable to set read mode for device %s (%s)", device, strerror(errno));
+	spi[channel].speed = speed;
+	spi[channel].mode = mode;
+
+	if(wiringXSPISetMode(channel, device) == -1) {
 		close(spi[channel].fd);
 		return -1;
 	}
@@ -505,35 +912,270 @@ EXPORT int wiringXSPISetup(int channel, int speed) {
 
 	return spi[channel].fd;
 }
+
+EXPORT int wiringXSPISetup(int channel, int speed) {
+	TIMING(channel & 1);
+	return wiringXSPISetupMode(channel, speed, SPIMODE_0);
+}
+
+/*
+ * Both chip selects share the SPI0 block, so direct
+ * mode on either channel locks out spidev users of
+ * both. Our own handles get their shared lock
+ * upgraded, the others are opened just for the lock.
+ */
+static int wiringXSPILockBus(void) {
+	int i = 0, fd = 0;
+
+	for(i=0;i<2;i++) {
+		if(spi[i].fd > 0) {
+			fd = spi[i].fd;
+		} else if((fd = spi_lock[i] = open(spi_device[i], O_RDWR)) < 0) {
+			/* An overlay may have disabled this chip select */
+			if(errno == ENOENT) {
+				continue;
+			}
+			break;
+		}
+		if(flock(fd, LOCK_EX | LOCK_NB) < 0) {
+			break;
+		}
+	}
+	if(i == 2) {
+		return 0;
+	}
+
+	wiringXLog(LOG_ERR, "wiringX SPI device %s is in use by another process (%s)", spi_device[i], strerror(errno));
+	for(;i>=0;i--) {
+		if(spi_lock[i] >= 0) {
+			close(spi_lock[i]);
+			spi_lock[i] = -1;
+		} else if(spi[i].fd > 0) {
+			flock(spi[i].fd, LOCK_SH);
+		}
+	}
+	return -1;
+}
+
+static void wiringXSPIUnlockBus(void) {
+	int i = 0;
+
+	for(i=0;i<2;i++) {
+		if(spi_lock[i] >= 0) {
+			close(spi_lock[i]);
+			spi_lock[i] = -1;
+		} else if(spi[i].fd > 0) {
+			flock(spi[i].fd, LOCK_SH);
+		}
+	}
+}
+
+EXPORT int wiringXSPISetupDirect(int channel) {
+	TIMING(channel & 1);
+	channel &= 1;
+
+	if(platform == NULL) {
+		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
+		return -1;
+	} else if(platform->spiSetup == NULL || platform->spiDataRW == NULL) {
+		wiringXLog(LOG_ERR, "The %s does not support the wiringXSPISetupDirect functionality", platform->name[namenr]);
+		return -1;
+	}
+	if(spi[channel].fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX SPI channel %d has to be setup before switching to direct mode", channel);
+		return -1;
+	}
+	if(spi[channel].direct == 1) {
+		return 0;
+	}
+
+	/*
+	 * The spidev handle stays open so the kernel keeps the
+	 * pins muxed, the bus lock keeps other wiringX users out.
+	 */
+	if(spi[channel ^ 1].direct == 0 && wiringXSPILockBus() < 0) {
+		return -1;
+	}
+	if(platform->spiSetup(channel, spi[channel].speed, spi[channel].mode) < 0) {
+		if(spi[channel ^ 1].direct == 0) {
+			wiringXSPIUnlockBus();
+		}
+		return -1;
+	}
+	spi[channel].direct = 1;
+
+	return 0;
+}
+
+EXPORT int wiringXSPIReleaseDirect(int channel) {
+	TIMING(channel & 1);
+	channel &= 1;
+
+	if(spi[channel].direct == 0) {
+		return 0;
+	}
+	if(platform != NULL && platform->spiRelease != NULL) {
+		platform->spiRelease(channel);
+	}
+	spi[channel].direct = 0;
+	if(spi[channel ^ 1].direct == 0) {
+		wiringXSPIUnlockBus();
+	}
+
+	return 0;
+}
+#endif
+
+static struct {
+	unsigned int baud;
+	speed_t speed;
+} bauds[] = {
+	{ 50, B50 },
+	{ 75, B75 },
+	{ 110, B110 },
+	{ 134, B134 },
+	{ 150, B150 },
+	{ 200, B200 },
+	{ 300, B300 },
+	{ 600, B600 },
+	{ 1200, B1200 },
+	{ 1800, B1800 },
+	{ 2400, B2400 },
+	{ 4800, B4800 },
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 },
+#ifdef B460800
+	{ 460800, B460800 },
+#endif
+#ifdef B500000
+	{ 500000, B500000 },
+#endif
+#ifdef B576000
+	{ 576000, B576000 },
+#endif
+#ifdef B921600
+	{ 921600, B921600 },
+#endif
+#ifdef B1000000
+	{ 1000000, B1000000 },
+#endif
+#ifdef B1152000
+	{ 1152000, B1152000 },
+#endif
+#ifdef B1500000
+	{ 1500000, B1500000 },
+#endif
+#ifdef B2000000
+	{ 2000000, B2000000 },
+#endif
+#ifdef B2500000
+	{ 2500000, B2500000 },
+#endif
+#ifdef B3000000
+	{ 3000000, B3000000 },
+#endif
+#ifdef B3500000
+	{ 3500000, B3500000 },
+#endif
+#ifdef B4000000
+	{ 4000000, B4000000 },
+#endif
+};
+
+static void wiringXSerialLatencyOptions(struct termios *options, enum serial_latency_t latency) {
+	switch(latency) {
+		case SERIAL_LATENCY_LOW:
+			options->c_cc[VMIN] = 1;
+			options->c_cc[VTIME] = 0;
+		break;
+		case SERIAL_LATENCY_THROUGHPUT:
+			/* Up to 255 bytes or a gap of 100ms, whichever comes first */
+			options->c_cc[VMIN] = 255;
+			options->c_cc[VTIME] = 1;
+		break;
+		default:
+			options->c_cc[VMIN] = 0;
+			options->c_cc[VTIME] = 150;
+		break;
+	}
+}
+
+#ifndef __FreeBSD__
+static void wiringXSerialSysfs(int fd, const char *attr, const char *value) {
+	char path[PATH_MAX], *name = NULL;
+	int sfd = 0;
+
+	if((name = ttyname(fd)) == NULL || (name = strrchr(name, '/')) == NULL) {
+		return;
+	}
+	snprintf(path, sizeof(path), "/sys/class/tty/%s/%s", name+1, attr);
+	if((sfd = open(path, O_WRONLY)) >= 0) {
+		if(write(sfd, value, strlen(value)) < 0) {
+			wiringXLog(LOG_DEBUG, "wiringX could not write %s to %s", value, path);
+		}
+		close(sfd);
+	}
+}
 #endif
 
+/*
+ * Driver side latency tuning, all best effort as
+ * most of it depends on the UART behind the port.
+ */
+static void wiringXSerialLatencyDriver(int fd, enum serial_latency_t latency) {
+#ifndef __FreeBSD__
+	struct serial_struct serial;
+
+	if(ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+		if(latency == SERIAL_LATENCY_LOW) {
+			serial.flags |= ASYNC_LOW_LATENCY;
+		} else {
+			serial.flags &= ~ASYNC_LOW_LATENCY;
+		}
+		ioctl(fd, TIOCSSERIAL, &serial);
+	}
+
+	/* 8250 receive FIFO trigger level and the FTDI USB latency timer */
+	if(latency == SERIAL_LATENCY_LOW) {
+		wiringXSerialSysfs(fd, "rx_trig_bytes", "1");
+		wiringXSerialSysfs(fd, "device/latency_timer", "1");
+	} else if(latency == SERIAL_LATENCY_THROUGHPUT) {
+		wiringXSerialSysfs(fd, "device/latency_timer", "16");
+	}
+#endif
+}
+
 EXPORT int wiringXSerialOpen(const char *device, struct wiringXSerial_t wiringXSerial) {
+	TIMING(-1);
 	struct termios options;
-	speed_t myBaud;
-	int status = 0, fd = 0;
-
-	switch(wiringXSerial.baud) {
-		case 50: myBaud = B50; break;
-		case 75: myBaud = B75; break;
-		case 110:	myBaud = B110; break;
-		case 134:	myBaud = B134; break;
-		case 150:	myBaud = B150; break;
-		case 200:	myBaud = B200; break;
-		case 300:	myBaud = B300; break;
-		case 600:	myBaud = B600; break;
-		case 1200: myBaud = B1200; break;
-		case 1800: myBaud = B1800; break;
-		case 2400: myBaud = B2400; break;
-		case 4800: myBaud = B4800; break;
-		case 9600: myBaud = B9600; break;
-		case 19200: myBaud = B19200; break;
-		case 38400: myBaud = B38400; break;
-		case 57600: myBaud = B57600; break;
-		case 115200: myBaud = B115200; break;
-		case 230400: myBaud = B230400; break;
-		default:
+	speed_t myBaud = B0;
+	int status = 0, fd = 0, custom = 0;
+	unsigned int i = 0;
+
+	for(i=0;i<sizeof(bauds)/sizeof(bauds[0]);i++) {
+		if(bauds[i].baud == wiringXSerial.baud) {
+			myBaud = bauds[i].speed;
+			break;
+		}
+	}
+	if(wiringXSerial.baud == 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface can not handle a baud rate of 0");
 		return -1;
 	}
+	if(i == sizeof(bauds)/sizeof(bauds[0])) {
+#ifdef __FreeBSD__
+		/* The speed is the baud rate itself */
+		myBaud = (speed_t)wiringXSerial.baud;
+#else
+		/* Placeholder until the real rate is set through termios2 */
+		myBaud = B38400;
+		custom = 1;
+#endif
+	}
 
 	if((fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK)) == -1) {
 		return -1;
@@ -623,6 +1265,14 @@ EXPORT int wiringXSerialOpen(const char *device, struct wiringXSerial_t wiringXS
 
 	tcsetattr(fd, TCSANOW | TCSAFLUSH, &options);
 
+#ifndef __FreeBSD__
+	if(custom == 1 && termios2_set_baud(fd, wiringXSerial.baud) < 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface can not handle a baud rate of %d (%s)", wiringXSerial.baud, strerror(errno));
+		close(fd);
+		return -1;
+	}
+#endif
+
 	ioctl(fd, TIOCMGET, &status);
 
 	status |= TIOCM_DTR;
@@ -633,7 +1283,123 @@ EXPORT int wiringXSerialOpen(const char *device, struct wiringXSerial_t wiringXS
 	return fd;
 }
 
+/*
+ * Returns the rate the port actually runs at,
+ * which can differ from the requested one when
+ * the UART clock can not divide down exactly.
+ */
+EXPORT int wiringXSerialGetBaud(int fd) {
+	TIMING(fd);
+	struct termios options;
+	speed_t speed = 0;
+	unsigned int i = 0;
+#ifndef __FreeBSD__
+	unsigned int baud = 0;
+#endif
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+
+#ifndef __FreeBSD__
+	if(termios2_get_baud(fd, &baud) == 0 && baud > 0) {
+		return (int)baud;
+	}
+#endif
+
+	if(tcgetattr(fd, &options) < 0) {
+		return -1;
+	}
+	speed = cfgetospeed(&options);
+	for(i=0;i<sizeof(bauds)/sizeof(bauds[0]);i++) {
+		if(bauds[i].speed == speed) {
+			return (int)bauds[i].baud;
+		}
+	}
+#ifdef __FreeBSD__
+	return (int)speed;
+#else
+	return -1;
+#endif
+}
+
+/*
+ * Applies a latency profile to an open port. This is
+ * not part of wiringXSerial_t, growing a struct that
+ * is passed by value would break existing binaries.
+ */
+EXPORT int wiringXSerialSetLatency(int fd, enum serial_latency_t latency) {
+	TIMING(fd);
+	struct termios options;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+	if(tcgetattr(fd, &options) < 0) {
+		return -1;
+	}
+	wiringXSerialLatencyOptions(&options, latency);
+	if(tcsetattr(fd, TCSANOW, &options) < 0) {
+		return -1;
+	}
+	wiringXSerialLatencyDriver(fd, latency);
+
+	return 0;
+}
+
+/*
+ * Sends single bytes and times how long it takes
+ * until they come back, so it needs a loopback
+ * wire or a peer that echoes.
+ */
+EXPORT int wiringXSerialMeasureLatency(int fd, int count, struct wiringXSerialLatency_t *result) {
+	TIMING(fd);
+	struct timespec start, end;
+	unsigned char tx = 0, rx = 0;
+	uint64_t ns = 0, total = 0;
+	int i = 0;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+
+	memset(result, 0, sizeof(struct wiringXSerialLatency_t));
+	tcflush(fd, TCIFLUSH);
+
+	for(i=0;i<count;i++) {
+		tx = (unsigned char)(0x55 ^ i);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if(wiringXSerialWrite(fd, &tx, 1) != 1) {
+			return -1;
+		}
+		if(wiringXSerialRead(fd, &rx, 1, 1000) != 1 || rx != tx) {
+			wiringXLog(LOG_ERR, "wiringX serial latency probe %d did not come back", i);
+			return -1;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		ns = (uint64_t)(end.tv_sec - start.tv_sec)*1000000000ULL + (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+		if(result->samples == 0 || ns < result->min_ns) {
+			result->min_ns = ns;
+		}
+		if(ns > result->max_ns) {
+			result->max_ns = ns;
+		}
+		total += ns;
+		result->samples++;
+	}
+	if(result->samples > 0) {
+		result->avg_ns = total / (uint64_t)result->samples;
+	}
+
+	return 0;
+}
+
 EXPORT void wiringXSerialFlush(int fd) {
+	TIMING(fd);
 	if(fd > 0) {
 		tcflush(fd, TCIOFLUSH);
 	} else {
@@ -642,14 +1408,21 @@ EXPORT void wiringXSerialFlush(int fd) {
 }
 
 EXPORT void wiringXSerialClose(int fd) {
+	TIMING(fd);
 	if(fd > 0) {
+#ifndef __FreeBSD__
+		rs485_close(fd);
+#endif
+		STATS_SERIAL_RESET(fd);
 		close(fd);
 	}
 }
 
 EXPORT void wiringXSerialPutChar(int fd, unsigned char c) {
+	TIMING(fd);
 	if(fd > 0) {
 		int x = write(fd, &c, 1);
+		STATS_SERIAL(fd, (x == 1) ? 0 : -1, 1, 0);
 		if(x != 1) {
 			wiringXLog(LOG_ERR, "wiringX failed to write to serial device");
 		}
@@ -659,9 +1432,9 @@ EXPORT void wiringXSerialPutChar(int fd, unsigned char c) {
 }
 
 EXPORT void wiringXSerialPuts(int fd, const char *s) {
+	TIMING(fd);
 	if(fd > 0) {
-		int x = write(fd, s, strlen(s));
-		if(x != strlen(s)) {
+		if(wiringXSerialWrite(fd, s, strlen(s)) < 0) {
 			wiringXLog(LOG_ERR, "wiringX failed to write to serial device");
 		}
 	} else {
@@ -669,7 +1442,272 @@ EXPORT void wiringXSerialPuts(int fd, const char *s) {
 	}
 }
 
+static int64_t wiringXSerialMillis(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+/*
+ * Wait until fd is ready for events, returns 1 when
+ * it is, 0 on timeout and -1 on error. A negative
+ * timeout waits forever.
+ */
+static int wiringXSerialWait(int fd, short events, int timeout) {
+	struct pollfd pfd;
+	int ret = 0;
+
+	pfd.fd = fd;
+	pfd.events = events;
+	pfd.revents = 0;
+
+	while((ret = poll(&pfd, 1, timeout)) < 0 && errno == EINTR);
+	if(ret > 0 && (pfd.revents & (POLLERR | POLLNVAL)) != 0) {
+		return -1;
+	}
+	return ret;
+}
+
+/*
+ * Reads up to len bytes, returning as soon as len bytes
+ * were read or timeout milliseconds have passed. A zero
+ * timeout only returns what is already buffered, a
+ * negative one waits until len bytes arrived.
+ */
+EXPORT int wiringXSerialRead(int fd, void *buf, size_t len, int timeout) {
+	TIMING(fd);
+	unsigned char *p = buf;
+	int64_t deadline = 0, now = 0;
+	size_t done = 0;
+	ssize_t n = 0;
+	int ret = 0, wait = timeout;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+
+	if(timeout > 0) {
+		deadline = wiringXSerialMillis() + timeout;
+	}
+
+	while(done < len) {
+		if((ret = wiringXSerialWait(fd, POLLIN, wait)) < 0) {
+			break;
+		} else if(ret == 0) {
+			break;
+		}
+
+		if((n = read(fd, &p[done], len - done)) < 0) {
+			if(errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			ret = -1;
+			break;
+		} else if(n == 0) {
+			/* The device went away */
+			break;
+		}
+		done += (size_t)n;
+
+		if(timeout > 0) {
+			now = wiringXSerialMillis();
+			if(now >= deadline) {
+				break;
+			}
+			wait = (int)(deadline - now);
+		}
+	}
+
+	ret = (ret < 0 && done == 0) ? -1 : (int)done;
+	STATS_SERIAL(fd, ret, 0, done);
+	return ret;
+}
+
+/*
+ * Time on the wire of a single character: start bit,
+ * data bits, optional parity bit and stop bits. Returns
+ * 0 when the baud rate can not be determined.
+ */
+EXPORT uint64_t wiringXSerialCharTime(int fd) {
+	TIMING(fd);
+	struct termios options;
+	int baud = 0, bits = 1;
+
+	if((baud = wiringXSerialGetBaud(fd)) <= 0 || tcgetattr(fd, &options) < 0) {
+		return 0;
+	}
+
+	switch(options.c_cflag & CSIZE) {
+		case CS5: bits += 5; break;
+		case CS6: bits += 6; break;
+		case CS7: bits += 7; break;
+		default: bits += 8; break;
+	}
+	bits += ((options.c_cflag & PARENB) == PARENB) ? 1 : 0;
+	bits += ((options.c_cflag & CSTOPB) == CSTOPB) ? 2 : 1;
+
+	return (uint64_t)bits * 1000000000ULL / (uint64_t)baud;
+}
+
+/*
+ * Reads whatever arrived, up to len bytes, with a
+ * single read and stamps it with the moment poll
+ * reported it. Returns the number of bytes, 0 on
+ * timeout. The character time is looked up once per
+ * chunk struct, clear it after changing the baud rate.
+ */
+EXPORT int wiringXSerialReadChunk(int fd, void *buf, size_t len, int timeout, struct wiringXSerialChunk_t *chunk) {
+	TIMING(fd);
+	struct timespec ts;
+	ssize_t n = 0;
+	int ret = 0;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+	if(chunk == NULL) {
+		return -1;
+	}
+	if(chunk->char_ns == 0) {
+		chunk->char_ns = wiringXSerialCharTime(fd);
+	}
+	chunk->len = 0;
+
+	while(1) {
+		if((ret = wiringXSerialWait(fd, POLLIN, timeout)) <= 0) {
+			return ret;
+		}
+		/* vDSO, no system call */
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+
+		if((n = read(fd, buf, len)) < 0) {
+			if(errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+			STATS_SERIAL(fd, -1, 0, 0);
+			return -1;
+		}
+		break;
+	}
+	STATS_SERIAL(fd, n, 0, n);
+
+	chunk->timestamp_ns = (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+	chunk->len = (size_t)n;
+
+	return (int)n;
+}
+
+/*
+ * Estimated arrival of byte i of a chunk. The bytes
+ * are assumed to have arrived back to back, ending
+ * with the last one at the chunk timestamp.
+ */
+EXPORT uint64_t wiringXSerialByteTime(const struct wiringXSerialChunk_t *chunk, size_t i) {
+	TIMING(-1);
+	if(chunk == NULL || i >= chunk->len) {
+		return 0;
+	}
+	return chunk->timestamp_ns - (uint64_t)(chunk->len - 1 - i) * chunk->char_ns;
+}
+
+/*
+ * Writes all len bytes, retrying short writes and
+ * waiting for room when the port is non-blocking.
+ */
+EXPORT int wiringXSerialWrite(int fd, const void *buf, size_t len) {
+	TIMING(fd);
+	const unsigned char *p = buf;
+	size_t done = 0;
+	ssize_t n = 0;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+
+	while(done < len) {
+		if((n = write(fd, &p[done], len - done)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EAGAIN && wiringXSerialWait(fd, POLLOUT, -1) > 0) {
+				continue;
+			}
+			STATS_SERIAL(fd, -1, 0, 0);
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	STATS_SERIAL(fd, 0, done, 0);
+
+	return (int)done;
+}
+
+/*
+ * Gathers several buffers into as few syscalls as
+ * possible, e.g. a header, payload and checksum.
+ */
+EXPORT int wiringXSerialWritev(int fd, const struct iovec *iov, int iovcnt) {
+	TIMING(fd);
+	struct iovec stack[16], *tmp = stack;
+	size_t total = 0, done = 0;
+	ssize_t n = 0;
+	int i = 0, first = 0;
+
+	if(fd <= 0) {
+		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
+		return -1;
+	}
+	if(iovcnt <= 0) {
+		return 0;
+	}
+
+	if(iovcnt > (int)(sizeof(stack)/sizeof(stack[0]))) {
+		if((tmp = malloc(sizeof(struct iovec)*iovcnt)) == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(-1);
+		}
+	}
+	memcpy(tmp, iov, sizeof(struct iovec)*iovcnt);
+	for(i=0;i<iovcnt;i++) {
+		total += iov[i].iov_len;
+	}
+
+	while(done < total) {
+		if((n = writev(fd, &tmp[first], iovcnt - first)) < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			if(errno == EAGAIN && wiringXSerialWait(fd, POLLOUT, -1) > 0) {
+				continue;
+			}
+			break;
+		}
+		done += (size_t)n;
+
+		/* Skip what was written and resume halfway a buffer */
+		while(first < iovcnt && (size_t)n >= tmp[first].iov_len) {
+			n -= (ssize_t)tmp[first].iov_len;
+			first++;
+		}
+		if(first < iovcnt) {
+			tmp[first].iov_base = (unsigned char *)tmp[first].iov_base + n;
+			tmp[first].iov_len -= (size_t)n;
+		}
+	}
+
+	if(tmp != stack) {
+		free(tmp);
+	}
+	STATS_SERIAL(fd, (done == total) ? 0 : -1, done, 0);
+
+	return (done == total) ? (int)done : -1;
+}
+
 EXPORT void wiringXSerialPrintf(int fd, const char *message, ...) {
+	TIMING(fd);
 	va_list argp;
 	char buffer[1024];
 
@@ -687,6 +1725,7 @@ EXPORT void wiringXSerialPrintf(int fd, const char *message, ...) {
 }
 
 EXPORT int wiringXSerialDataAvail(int fd) {
+	TIMING(fd);
 	int result = 0;
 
 	if(fd > 0) {
@@ -701,12 +1740,15 @@ EXPORT int wiringXSerialDataAvail(int fd) {
 }
 
 EXPORT int wiringXSerialGetChar(int fd) {
+	TIMING(fd);
 	uint8_t x = 0;
 
 	if(fd > 0) {
 		if(read(fd, &x, 1) != 1) {
+			STATS_SERIAL(fd, -1, 0, 0);
 			return -1;
 		}
+		STATS_SERIAL(fd, 0, 0, 1);
 		return ((int)x) & 0xFF;
 	} else {
 		wiringXLog(LOG_ERR, "wiringX serial interface has not been opened");
@@ -715,6 +1757,7 @@ EXPORT int wiringXSerialGetChar(int fd) {
 }
 
 EXPORT int wiringXSelectableFd(int gpio) {
+	TIMING(gpio);
 	if(platform == NULL) {
 		wiringXLog(LOG_ERR, "wiringX has not been properly setup (no platform has been selected)");
 		return -1;
@@ -726,18 +1769,33 @@ EXPORT int wiringXSelectableFd(int gpio) {
 }
 
 EXPORT int wiringXGC(void) {
+	TIMING(-1);
+#ifndef __FreeBSD__
+	wiringXSPIReleaseDirect(0);
+	wiringXSPIReleaseDirect(1);
+#endif
 	if(platform != NULL) {
 		platform->gc();
 		platform = NULL;
 	}
 	platform_gc();
 	soc_gc();
+#ifndef __FreeBSD__
+	pthread_mutex_lock(&i2c_addr_lock);
+	if(i2c_addr != NULL) {
+		free(i2c_addr);
+		i2c_addr = NULL;
+		i2c_addr_size = 0;
+	}
+	pthread_mutex_unlock(&i2c_addr_lock);
+#endif
 	issetup = 0;
 	isinit = 0;
 	return 0;
 }
 
 EXPORT int wiringXSupportedPlatforms(char ***out) {
+	TIMING(-1);
 	wiringXInit();
 	char *tmp = NULL;
 	int i = 0, x = 0;
@@ -14,7 +14,10 @@ extern "C" {
 #endif
 
 #include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <syslog.h>
+#include <sys/uio.h>
 
 #define wiringXLog(a, b, ...) _wiringXLog(a, __FILE__, __LINE__, b, ##__VA_ARGS__)
 
@@ -58,6 +61,67 @@ enum digital_value_t {
 	HIGH
 };
 
+/*
+ * Mirrors the Linux SPI mode bits so they can be
+ * passed straight to SPI_IOC_WR_MODE32.
+ */
+enum spimode_t {
+	SPIMODE_CPHA = 0x01,
+	SPIMODE_CPOL = 0x02,
+	SPIMODE_0 = 0x00,
+	SPIMODE_1 = 0x01,
+	SPIMODE_2 = 0x02,
+	SPIMODE_3 = 0x03,
+	SPIMODE_CS_HIGH = 0x04,
+	SPIMODE_LSB_FIRST = 0x08,
+	SPIMODE_3WIRE = 0x10,
+	SPIMODE_LOOP = 0x20,
+	SPIMODE_NO_CS = 0x40,
+	SPIMODE_READY = 0x80,
+	SPIMODE_TX_DUAL = 0x100,
+	SPIMODE_TX_QUAD = 0x200,
+	SPIMODE_RX_DUAL = 0x400,
+	SPIMODE_RX_QUAD = 0x800
+};
+
+/* Largest SMBus / I2C block transfer */
+#define I2C_BLOCK_MAX	32
+
+enum i2cmsg_t {
+	I2CMSG_WRITE = 0x0000,
+	I2CMSG_READ = 0x0001,
+	I2CMSG_TEN = 0x0010,
+	I2CMSG_NOSTART = 0x4000
+};
+
+/*
+ * One segment of a combined I2C transaction, every
+ * segment after the first starts with a repeated start.
+ */
+typedef struct wiringXI2CMsg_t {
+	unsigned short addr;
+	unsigned short flags;
+	unsigned short len;
+	unsigned char *buf;
+} wiringXI2CMsg_t;
+
+typedef struct wiringXI2CBusStats_t {
+	uint64_t transfers;
+	uint64_t ioctls;
+	/* Transfers that shared an ioctl with an earlier one */
+	uint64_t coalesced;
+	uint64_t errors;
+} wiringXI2CBusStats_t;
+
+enum serial_latency_t {
+	/* VMIN 0 and VTIME 15 seconds, driver defaults */
+	SERIAL_LATENCY_DEFAULT = 0,
+	/* Return on the first byte and ask the driver to deliver immediately */
+	SERIAL_LATENCY_LOW = 1,
+	/* Wait for larger chunks and let the driver batch */
+	SERIAL_LATENCY_THROUGHPUT = 2
+};
+
 typedef struct wiringXSerial_t {
 	unsigned int baud;
 	unsigned int databits;
@@ -66,6 +130,119 @@ typedef struct wiringXSerial_t {
 	unsigned int flowcontrol;
 } wiringXSerial_t;
 
+enum rs485_mode_t {
+	RS485_MODE_OFF = 0,
+	/* The UART driver toggles RTS through TIOCSRS485 */
+	RS485_MODE_KERNEL = 1,
+	/* wiringXSerialRS485Write drives a GPIO */
+	RS485_MODE_GPIO = 2
+};
+
+typedef struct wiringXRS485_t {
+	/* Driver enable GPIO for drivers without RS-485 support, -1 for none */
+	int gpio;
+	/* Level of the driver enable line while sending */
+	enum digital_value_t active;
+	unsigned int delay_before_us;
+	unsigned int delay_after_us;
+	/* Use the GPIO even when the driver supports RS-485 */
+	int force_gpio;
+} wiringXRS485_t;
+
+typedef struct wiringXSerialLatency_t {
+	int samples;
+	uint64_t min_ns;
+	uint64_t avg_ns;
+	uint64_t max_ns;
+} wiringXSerialLatency_t;
+
+/*
+ * Filled in by wiringXSerialReadChunk. Timestamps are
+ * CLOCK_MONOTONIC nanoseconds, the clock the kernel
+ * also uses for GPIO edge events.
+ */
+typedef struct wiringXSerialChunk_t {
+	/* When the data was found waiting, the last byte arrived before it */
+	uint64_t timestamp_ns;
+	/* Time on the wire per character, kept between calls when set */
+	uint64_t char_ns;
+	size_t len;
+} wiringXSerialChunk_t;
+
+/*
+ * One segment of a SPI message. Either tx or rx
+ * may be NULL for half-duplex segments. Zero values
+ * for speed, delay and bits_per_word fall back to
+ * the channel defaults. The nbits fields select a
+ * single (0 or 1), dual (2) or quad (4) wire phase
+ * and need the matching SPIMODE_TX/RX flags.
+ */
+typedef struct wiringXSPITransfer_t {
+	const unsigned char *tx;
+	unsigned char *rx;
+	unsigned int len;
+	unsigned int speed;
+	unsigned short delay;
+	unsigned char bits_per_word;
+	unsigned char tx_nbits;
+	unsigned char rx_nbits;
+	unsigned char cs_change;
+} wiringXSPITransfer_t;
+
+/*
+ * Operation counters, filled in by wiringXStats.
+ * Pins are wiringX numbers, I2C and serial buses
+ * are counted per file descriptor. Pins and fds
+ * beyond the tables are not counted.
+ */
+#define WIRINGX_STATS_PINS	256
+#define WIRINGX_STATS_FDS		256
+
+typedef struct wiringXPinStats_t {
+	uint64_t writes;
+	uint64_t reads;
+	/* pinMode and wiringXISR calls */
+	uint64_t modes;
+	/* waitForInterrupt calls that saw an edge */
+	uint64_t interrupts;
+	uint64_t errors;
+} wiringXPinStats_t;
+
+typedef struct wiringXBusStats_t {
+	uint64_t transactions;
+	uint64_t tx_bytes;
+	uint64_t rx_bytes;
+	uint64_t errors;
+} wiringXBusStats_t;
+
+typedef struct wiringXStats_t {
+	struct wiringXPinStats_t pins[WIRINGX_STATS_PINS];
+	struct wiringXBusStats_t spi[2];
+	struct wiringXBusStats_t i2c[WIRINGX_STATS_FDS];
+	struct wiringXBusStats_t serial[WIRINGX_STATS_FDS];
+} wiringXStats_t;
+
+/*
+ * Call durations of a public function, filled in by
+ * wiringXTimingSnapshot. The percentiles are bucket
+ * bounds and at most 1/16th above the real value.
+ * Timing adds two clock_gettime calls and an atomic
+ * add to every call, wiringx-bench -t shows what
+ * that costs on a platform.
+ */
+typedef struct wiringXTiming_t {
+	/* Name of the function */
+	const char *name;
+	/* Pin, SPI channel or fd, -1 for all calls of the function */
+	int key;
+	uint64_t count;
+	uint64_t p50_ns;
+	uint64_t p90_ns;
+	uint64_t p99_ns;
+	uint64_t p999_ns;
+	uint64_t max_ns;
+} wiringXTiming_t;
+
 void delayMicroseconds(unsigned int);
 int pinMode(int, enum pinmode_t);
 int wiringXSetup(char *name, void (*func)(int, char *, int, const char *, ...));
@@ -84,12 +261,34 @@ int wiringXI2CWrite(int, int);
 int wiringXI2CWriteReg8(int, int, int);
 int wiringXI2CWriteReg16(int, int, int);
 int wiringXI2CSetup(const char *, int);
+void wiringXI2CClose(int);
+int wiringXI2CReadBlock(int, int, unsigned char *);
+int wiringXI2CWriteBlock(int, int, const unsigned char *, int);
+int wiringXI2CReadI2CBlock(int, int, unsigned char *, int);
+int wiringXI2CWriteI2CBlock(int, int, const unsigned char *, int);
+int wiringXI2CTransfer(int, struct wiringXI2CMsg_t *, int);
+int wiringXI2CReadRegs(int, int, unsigned char *, int);
+int wiringXI2CWriteRegs(int, int, const unsigned char *, int);
+int wiringXI2CBusOpen(const char *);
+int wiringXI2CBusClose(int);
+int wiringXI2CBusCoalesce(int, int);
+int wiringXI2CBusTransfer(int, struct wiringXI2CMsg_t *, int);
+int wiringXI2CBusReadRegs(int, int, int, unsigned char *, int);
+int wiringXI2CBusWriteRegs(int, int, int, const unsigned char *, int);
+int wiringXI2CBusStats(int, struct wiringXI2CBusStats_t *);
 
 int wiringXSPIGetFd(int channel);
 int wiringXSPIDataRW(int channel, unsigned char *data, int len);
 int wiringXSPISetup(int channel, int speed);
+int wiringXSPISetupMode(int channel, int speed, unsigned int mode);
+int wiringXSPITransfer(int channel, struct wiringXSPITransfer_t *xfers, int n);
+int wiringXSPISetupDirect(int channel);
+int wiringXSPIReleaseDirect(int channel);
 
 int wiringXSerialOpen(const char *, struct wiringXSerial_t);
+int wiringXSerialGetBaud(int);
+int wiringXSerialSetLatency(int, enum serial_latency_t);
+int wiringXSerialMeasureLatency(int, int, struct wiringXSerialLatency_t *);
 void wiringXSerialFlush(int);
 void wiringXSerialClose(int);
 void wiringXSerialPutChar(int, unsigned char);
@@ -97,11 +296,27 @@ void wiringXSerialPuts(int, const char *);
 void wiringXSerialPrintf(int, const char *, ...);
 int wiringXSerialDataAvail(int);
 int wiringXSerialGetChar(int);
+int wiringXSerialRead(int, void *, size_t, int);
+int wiringXSerialReadChunk(int, void *, size_t, int, struct wiringXSerialChunk_t *);
+uint64_t wiringXSerialByteTime(const struct wiringXSerialChunk_t *, size_t);
+uint64_t wiringXSerialCharTime(int);
+int wiringXSerialWrite(int, const void *, size_t);
+int wiringXSerialWritev(int, const struct iovec *, int);
+int wiringXSerialRS485(int, struct wiringXRS485_t);
+int wiringXSerialRS485Disable(int);
+int wiringXSerialRS485Write(int, const void *, size_t);
 
+int wiringXSimulate(int);
 char *wiringXPlatform(void);
 int wiringXValidGPIO(int);
 int wiringXSelectableFd(int);
 int wiringXSupportedPlatforms(char ***);
+int wiringXStats(struct wiringXStats_t *);
+int wiringXStatsDump(int);
+int wiringXTiming(int);
+int wiringXTimingSnapshot(struct wiringXTiming_t **);
+void wiringXTimingReset(void);
+int wiringXTimingDump(int, unsigned int);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,174 @@
+/*
+	Copyright (c) 2016 CurlyMo <curlymoo1@gmail.com>
+
+  This Source Code Form is subject to the terms of the Mozilla Public
+  License, v. 2.0. If a copy of the MPL was not distributed with this
+  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "wiringx.h"
+#include "soc/soc.h"
+#include "soc/broadcom/spi0.h"
+
+/*
+ * Runs the Broadcom SPI0 driver against the simulated
+ * registers. A thread stands in for the controller:
+ * once the driver starts a transfer it records what
+ * was programmed and raises the FIFO and DONE flags.
+ * The simulated FIFO keeps the words the driver wrote
+ * and hands out the words queued for it to read.
+ */
+
+#define SPI0_CS		0x00
+#define SPI0_FIFO	0x04
+#define SPI0_CLK	0x08
+
+#define SPI0_CS_CPHA			(1 << 2)
+#define SPI0_CS_CPOL			(1 << 3)
+#define SPI0_CS_CLEAR_TX	(1 << 4)
+#define SPI0_CS_CLEAR_RX	(1 << 5)
+#define SPI0_CS_CSPOL			(1 << 6)
+#define SPI0_CS_TA				(1 << 7)
+#define SPI0_CS_STATUS		((1 << 16) | (1 << 17) | (1 << 18))
+
+/* What the kernel driver left behind */
+#define KERNEL_CS		(SPI0_CS_TA | SPI0_CS_CPOL | 1)
+#define KERNEL_CLK	500
+
+struct controller_t {
+	volatile uint32_t *cs;
+	volatile uint32_t *clk;
+	uint32_t expect;
+	uint32_t seen_cs;
+	uint32_t seen_clk;
+};
+
+static int failures = 0;
+
+static void check(const char *what, uint32_t got, uint32_t expect) {
+	if(got != expect) {
+		printf("FAIL %s: 0x%08x, expected 0x%08x\n", what, got, expect);
+		failures++;
+	} else {
+		printf("ok   %s: 0x%08x\n", what, got);
+	}
+}
+
+static void *controller(void *param) {
+	struct controller_t *ctrl = param;
+	uint32_t cs = 0;
+
+	while(((cs = *ctrl->cs) & ~SPI0_CS_STATUS) != (ctrl->expect | SPI0_CS_TA)) {
+		sched_yield();
+	}
+	ctrl->seen_cs = cs;
+	ctrl->seen_clk = *ctrl->clk;
+	*ctrl->cs = cs | SPI0_CS_STATUS;
+	return NULL;
+}
+
+static void transfer(struct soc_t *soc, struct controller_t *ctrl, int channel, uint32_t cs, uint32_t clk) {
+	unsigned char data[4] = { 0x01, 0x02, 0x03, 0x04 };
+	uintptr_t fifo = soc->base_addr[1] + soc->base_offs[1] + SPI0_FIFO;
+	uint32_t val = 0;
+	pthread_t thread;
+	char what[64];
+	unsigned int i = 0;
+
+	for(i=0;i<sizeof(data);i++) {
+		soc_sim_fifo_push(fifo, 0xA0 + i);
+	}
+
+	ctrl->expect = cs;
+	ctrl->seen_cs = 0;
+	ctrl->seen_clk = 0;
+	pthread_create(&thread, NULL, controller, ctrl);
+	snprintf(what, sizeof(what), "channel %d transfer", channel);
+	check(what, (uint32_t)broadcomSPI0DataRW(soc, channel, data, sizeof(data)), 0);
+	pthread_join(thread, NULL);
+
+	for(i=0;i<sizeof(data);i++) {
+		val = 0;
+		snprintf(what, sizeof(what), "channel %d TX byte %u", channel, i);
+		check(what, (soc_sim_fifo_pop(fifo, &val) == 0) ? val : 0xFFFFFFFF, i + 1);
+		snprintf(what, sizeof(what), "channel %d RX byte %u", channel, i);
+		check(what, data[i], 0xA0 + i);
+	}
+	snprintf(what, sizeof(what), "channel %d TX drained", channel);
+	check(what, (uint32_t)soc_sim_fifo_pop(fifo, &val), (uint32_t)-1);
+
+	snprintf(what, sizeof(what), "channel %d CS during transfer", channel);
+	check(what, ctrl->seen_cs, cs | SPI0_CS_TA);
+	snprintf(what, sizeof(what), "channel %d CDIV during transfer", channel);
+	check(what, ctrl->seen_clk, clk);
+	snprintf(what, sizeof(what), "channel %d CS after transfer", channel);
+	check(what, *ctrl->cs & ~SPI0_CS_STATUS, (KERNEL_CS & ~SPI0_CS_TA) | SPI0_CS_CLEAR_TX | SPI0_CS_CLEAR_RX);
+	snprintf(what, sizeof(what), "channel %d CLK after transfer", channel);
+	check(what, *ctrl->clk, KERNEL_CLK);
+}
+
+int main(void) {
+	struct controller_t ctrl;
+	struct soc_t *soc = NULL;
+	uintptr_t addr = 0;
+	void *regs = NULL;
+
+	wiringXSimulate(1);
+	if(wiringXSetup("raspberrypi3", NULL) != 0) {
+		printf("FAIL could not setup the simulated raspberrypi3\n");
+		return EXIT_FAILURE;
+	}
+	soc = soc_get("Broadcom", "2836");
+
+	/* Mapping the same area again shares the simulated registers */
+	addr = soc->base_addr[1];
+	if((regs = soc_mmap(soc, addr)) == NULL) {
+		printf("FAIL could not map the simulated SPI0 registers\n");
+		return EXIT_FAILURE;
+	}
+	ctrl.cs = (volatile uint32_t *)((uintptr_t)regs + soc->base_offs[1] + SPI0_CS);
+	ctrl.clk = (volatile uint32_t *)((uintptr_t)regs + soc->base_offs[1] + SPI0_CLK);
+	*ctrl.cs = KERNEL_CS;
+	*ctrl.clk = KERNEL_CLK;
+
+	/* 400 MHz / 1 MHz divides evenly */
+	check("channel 0 setup", (uint32_t)broadcomSPI0Setup(soc, 0, 1000000, SPIMODE_3, 400000000), 0);
+	check("channel 0 setup leaves CS", *ctrl.cs, KERNEL_CS);
+	transfer(soc, &ctrl, 0, SPI0_CS_CPHA | SPI0_CS_CPOL, 400);
+
+	/* 400 MHz / 3 MHz gives 134, rounded up to stay below 3 MHz */
+	*ctrl.cs = KERNEL_CS;
+	check("channel 1 setup", (uint32_t)broadcomSPI0Setup(soc, 1, 3000000, SPIMODE_1 | SPIMODE_CS_HIGH, 400000000), 0);
+	transfer(soc, &ctrl, 1, 1 | SPI0_CS_CPHA | SPI0_CS_CSPOL, 134);
+
+	/* Too slow for the divider falls back to the slowest clock */
+	*ctrl.cs = KERNEL_CS;
+	check("channel 0 setup slow", (uint32_t)broadcomSPI0Setup(soc, 0, 1000, SPIMODE_0, 400000000), 0);
+	transfer(soc, &ctrl, 0, 0, 0);
+
+	*ctrl.cs = SPI0_CS_STATUS;
+	*ctrl.clk = 0;
+	broadcomSPI0Release(soc, 0);
+	check("channel 0 release CS", *ctrl.cs, KERNEL_CS & ~SPI0_CS_TA);
+	check("channel 0 release CLK", *ctrl.clk, KERNEL_CLK);
+	check("channel 1 keeps SPI0 mapped", (soc->gpio[1] != NULL), 1);
+
+	*ctrl.cs = SPI0_CS_STATUS;
+	*ctrl.clk = 0;
+	broadcomSPI0Release(soc, 1);
+	check("channel 1 release CS", *ctrl.cs, KERNEL_CS & ~SPI0_CS_TA);
+	check("channel 1 release CLK", *ctrl.clk, KERNEL_CLK);
+	check("SPI0 unmapped", (soc->gpio[1] == NULL), 1);
+
+	soc_munmap(soc, regs);
+	wiringXGC();
+
+	return (failures > 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+}